@@ -39,6 +39,30 @@ typedef ptrdiff_t intptr_t;
 #define ARGON2_QWORDS_IN_BLOCK (ARGON2_BLOCK_SIZE / 8)
 #define ARGON2_SYNC_POINTS 4
 
+/*
+ * Programs built for a single parameter set (see KernelLoader) get the time
+ * cost, lanes and segment blocks as constants. The kernels overwrite their
+ * arguments with them, so that the compiler can fold the address math and
+ * the divisions and modulos in compute_ref_pos; the host passes the same
+ * values either way.
+ */
+#ifdef ARGON2_PASSES
+#define SPECIALIZE_PASSES(passes) (passes) = ARGON2_PASSES
+#else
+#define SPECIALIZE_PASSES(passes) (void)0
+#endif
+#ifdef ARGON2_LANES
+#define SPECIALIZE_LANES(lanes) (lanes) = ARGON2_LANES
+#else
+#define SPECIALIZE_LANES(lanes) (void)0
+#endif
+#ifdef ARGON2_SEGMENT_BLOCKS
+#define SPECIALIZE_SEGMENT_BLOCKS(segment_blocks) \
+    (segment_blocks) = ARGON2_SEGMENT_BLOCKS
+#else
+#define SPECIALIZE_SEGMENT_BLOCKS(segment_blocks) (void)0
+#endif
+
 #define THREADS_PER_LANE 32
 #define QWORDS_PER_THREAD (ARGON2_QWORDS_IN_BLOCK / 32)
 
@@ -421,6 +445,10 @@ __kernel void argon2_precompute_kernel(
         __local struct u64_shuffle_buf *shuffle_bufs, __global struct ref *refs,
         uint passes, uint lanes, uint segment_blocks)
 {
+    SPECIALIZE_PASSES(passes);
+    SPECIALIZE_LANES(lanes);
+    SPECIALIZE_SEGMENT_BLOCKS(segment_blocks);
+
     uint block_id = get_global_id(0) / THREADS_PER_LANE;
     uint warp = get_local_id(0) / THREADS_PER_LANE;
     uint thread = get_local_id(0) % THREADS_PER_LANE;
@@ -538,7 +566,12 @@ __kernel void argon2_kernel_segment_precompute(
         uint passes, uint lanes, uint segment_blocks,
         uint pass, uint slice)
 {
-    uint job_id = get_global_id(1);
+    SPECIALIZE_PASSES(passes);
+    SPECIALIZE_LANES(lanes);
+    SPECIALIZE_SEGMENT_BLOCKS(segment_blocks);
+
+    /* the memory buffer starts at the global offset's job: */
+    uint job_id = get_global_id(1) - get_global_offset(1);
     uint lane   = get_global_id(0) / THREADS_PER_LANE;
     uint warp   = (get_local_id(1) * get_local_size(0) + get_local_id(0))
             / THREADS_PER_LANE;
@@ -597,7 +630,12 @@ __kernel void argon2_kernel_oneshot_precompute(
         __global struct block_g *memory, __global const struct ref *refs,
         uint passes, uint lanes, uint segment_blocks)
 {
-    uint job_id = get_global_id(1);
+    SPECIALIZE_PASSES(passes);
+    SPECIALIZE_LANES(lanes);
+    SPECIALIZE_SEGMENT_BLOCKS(segment_blocks);
+
+    /* the memory buffer starts at the global offset's job: */
+    uint job_id = get_global_id(1) - get_global_offset(1);
     uint lane   = get_global_id(0) / THREADS_PER_LANE;
     uint warp   = get_local_id(1) * lanes + get_local_id(0) / THREADS_PER_LANE;
     uint thread = get_local_id(0) % THREADS_PER_LANE;
@@ -698,7 +736,12 @@ __kernel void argon2_kernel_segment(
         __global struct block_g *memory, uint passes, uint lanes,
         uint segment_blocks, uint pass, uint slice)
 {
-    uint job_id = get_global_id(1);
+    SPECIALIZE_PASSES(passes);
+    SPECIALIZE_LANES(lanes);
+    SPECIALIZE_SEGMENT_BLOCKS(segment_blocks);
+
+    /* the memory buffer starts at the global offset's job: */
+    uint job_id = get_global_id(1) - get_global_offset(1);
     uint lane   = get_global_id(0) / THREADS_PER_LANE;
     uint warp   = (get_local_id(1) * get_local_size(0) + get_local_id(0))
             / THREADS_PER_LANE;
@@ -781,7 +824,12 @@ __kernel void argon2_kernel_oneshot(
         __global struct block_g *memory, uint passes, uint lanes,
         uint segment_blocks)
 {
-    uint job_id = get_global_id(1);
+    SPECIALIZE_PASSES(passes);
+    SPECIALIZE_LANES(lanes);
+    SPECIALIZE_SEGMENT_BLOCKS(segment_blocks);
+
+    /* the memory buffer starts at the global offset's job: */
+    uint job_id = get_global_id(1) - get_global_offset(1);
     uint lane   = get_global_id(0) / THREADS_PER_LANE;
     uint warp   = get_local_id(1) * lanes + get_local_id(0) / THREADS_PER_LANE;
     uint thread = get_local_id(0) % THREADS_PER_LANE;
@@ -867,3 +915,330 @@ __kernel void argon2_kernel_oneshot(
         mem_curr = mem_lane;
     }
 }
+
+/*
+ * Blake2b, used by the initialization and finalization kernels below (this
+ * is the work done by Argon2Params::fillFirstBlocks() and finalize() on the
+ * host when the kernels are not used):
+ */
+#define BLAKE2B_BLOCK_BYTES 128
+#define BLAKE2B_OUT_BYTES 64
+
+__constant ulong blake2b_iv[8] = {
+    0x6a09e667f3bcc908UL, 0xbb67ae8584caa73bUL,
+    0x3c6ef372fe94f82bUL, 0xa54ff53a5f1d36f1UL,
+    0x510e527fade682d1UL, 0x9b05688c2b3e6c1fUL,
+    0x1f83d9abfb41bd6bUL, 0x5be0cd19137e2179UL,
+};
+
+__constant uchar blake2b_sigma[12][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+};
+
+struct blake2b_state {
+    ulong h[8];
+    ulong t;
+    uint buf_len;
+    uint out_len;
+    uchar buf[BLAKE2B_BLOCK_BYTES];
+};
+
+ulong load64_le(const uchar *src)
+{
+    ulong res = 0;
+    for (uint i = 0; i < 8; i++) {
+        res |= (ulong)src[i] << (8 * i);
+    }
+    return res;
+}
+
+void store32_le(uchar *dst, uint value)
+{
+    for (uint i = 0; i < 4; i++) {
+        dst[i] = (uchar)(value >> (8 * i));
+    }
+}
+
+void store64_le(uchar *dst, ulong value)
+{
+    for (uint i = 0; i < 8; i++) {
+        dst[i] = (uchar)(value >> (8 * i));
+    }
+}
+
+#define BLAKE2B_G(a, b, c, d, x, y) \
+    do { \
+        a = a + b + x; \
+        d = rotr64(d ^ a, 32); \
+        c = c + d; \
+        b = rotr64(b ^ c, 24); \
+        a = a + b + y; \
+        d = rotr64(d ^ a, 16); \
+        c = c + d; \
+        b = rotr64(b ^ c, 63); \
+    } while (0)
+
+void blake2b_compress(struct blake2b_state *state, bool last)
+{
+    ulong m[16], v[16];
+    for (uint i = 0; i < 16; i++) {
+        m[i] = load64_le(state->buf + i * 8);
+    }
+    for (uint i = 0; i < 8; i++) {
+        v[i] = state->h[i];
+        v[i + 8] = blake2b_iv[i];
+    }
+    /* inputs are far shorter than 2^64 bytes, so the high counter word
+     * (v[13]) is left alone: */
+    v[12] ^= state->t;
+    if (last) {
+        v[14] = ~v[14];
+    }
+
+    for (uint r = 0; r < 12; r++) {
+        __constant const uchar *s = blake2b_sigma[r];
+
+        BLAKE2B_G(v[0], v[4], v[ 8], v[12], m[s[ 0]], m[s[ 1]]);
+        BLAKE2B_G(v[1], v[5], v[ 9], v[13], m[s[ 2]], m[s[ 3]]);
+        BLAKE2B_G(v[2], v[6], v[10], v[14], m[s[ 4]], m[s[ 5]]);
+        BLAKE2B_G(v[3], v[7], v[11], v[15], m[s[ 6]], m[s[ 7]]);
+        BLAKE2B_G(v[0], v[5], v[10], v[15], m[s[ 8]], m[s[ 9]]);
+        BLAKE2B_G(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+        BLAKE2B_G(v[2], v[7], v[ 8], v[13], m[s[12]], m[s[13]]);
+        BLAKE2B_G(v[3], v[4], v[ 9], v[14], m[s[14]], m[s[15]]);
+    }
+
+    for (uint i = 0; i < 8; i++) {
+        state->h[i] ^= v[i] ^ v[i + 8];
+    }
+}
+
+void blake2b_init(struct blake2b_state *state, uint out_len)
+{
+    for (uint i = 0; i < 8; i++) {
+        state->h[i] = blake2b_iv[i];
+    }
+    state->h[0] ^= 0x01010000UL ^ out_len;
+    state->t = 0;
+    state->buf_len = 0;
+    state->out_len = out_len;
+}
+
+void blake2b_update(struct blake2b_state *state, const uchar *in, uint in_len)
+{
+    while (in_len > 0) {
+        /* the last block must be compressed by blake2b_final(), so only
+         * compress a full buffer once more input arrives: */
+        if (state->buf_len == BLAKE2B_BLOCK_BYTES) {
+            state->t += BLAKE2B_BLOCK_BYTES;
+            blake2b_compress(state, false);
+            state->buf_len = 0;
+        }
+
+        uint take = min(in_len, BLAKE2B_BLOCK_BYTES - state->buf_len);
+        for (uint i = 0; i < take; i++) {
+            state->buf[state->buf_len + i] = in[i];
+        }
+        state->buf_len += take;
+        in += take;
+        in_len -= take;
+    }
+}
+
+void blake2b_final(struct blake2b_state *state, uchar *out)
+{
+    state->t += state->buf_len;
+    for (uint i = state->buf_len; i < BLAKE2B_BLOCK_BYTES; i++) {
+        state->buf[i] = 0;
+    }
+    blake2b_compress(state, true);
+
+    uchar res[BLAKE2B_OUT_BYTES];
+    for (uint i = 0; i < 8; i++) {
+        store64_le(res + i * 8, state->h[i]);
+    }
+    for (uint i = 0; i < state->out_len; i++) {
+        out[i] = res[i];
+    }
+}
+
+/* The variable-length hash function H' from the Argon2 specification: */
+void blake2b_digest_long(__global uchar *out, uint out_len,
+                         const uchar *in, uint in_len)
+{
+    struct blake2b_state state;
+    uchar out_len_bytes[4];
+    uchar buffer[BLAKE2B_OUT_BYTES];
+
+    store32_le(out_len_bytes, out_len);
+
+    if (out_len <= BLAKE2B_OUT_BYTES) {
+        blake2b_init(&state, out_len);
+        blake2b_update(&state, out_len_bytes, 4);
+        blake2b_update(&state, in, in_len);
+        blake2b_final(&state, buffer);
+
+        for (uint i = 0; i < out_len; i++) {
+            out[i] = buffer[i];
+        }
+        return;
+    }
+
+    blake2b_init(&state, BLAKE2B_OUT_BYTES);
+    blake2b_update(&state, out_len_bytes, 4);
+    blake2b_update(&state, in, in_len);
+    blake2b_final(&state, buffer);
+
+    for (uint i = 0; i < BLAKE2B_OUT_BYTES / 2; i++) {
+        out[i] = buffer[i];
+    }
+    out += BLAKE2B_OUT_BYTES / 2;
+
+    uint to_produce = out_len - BLAKE2B_OUT_BYTES / 2;
+    while (to_produce > BLAKE2B_OUT_BYTES) {
+        blake2b_init(&state, BLAKE2B_OUT_BYTES);
+        blake2b_update(&state, buffer, BLAKE2B_OUT_BYTES);
+        blake2b_final(&state, buffer);
+
+        for (uint i = 0; i < BLAKE2B_OUT_BYTES / 2; i++) {
+            out[i] = buffer[i];
+        }
+        out += BLAKE2B_OUT_BYTES / 2;
+        to_produce -= BLAKE2B_OUT_BYTES / 2;
+    }
+
+    blake2b_init(&state, to_produce);
+    blake2b_update(&state, buffer, BLAKE2B_OUT_BYTES);
+    blake2b_final(&state, buffer);
+
+    for (uint i = 0; i < to_produce; i++) {
+        out[i] = buffer[i];
+    }
+}
+
+#define ARGON2_PREHASH_DIGEST_LENGTH 64
+#define ARGON2_PREHASH_SEED_LENGTH 72
+
+/*
+ * Fills the first two blocks of every lane from the jobs' initial hashes
+ * (H0, ARGON2_PREHASH_DIGEST_LENGTH bytes per job, computed on the host).
+ * Global size: (2 * lanes, batch size); work-item (i, job) fills block
+ * i / lanes of lane i % lanes, which is exactly the i-th block of the job's
+ * memory. The memory buffer holds the jobs from the global offset on (the
+ * runner launches one range per memory buffer); the seeds are indexed by
+ * the absolute job.
+ */
+__kernel void argon2_init_kernel(
+        __global const uchar *seeds, __global struct block_g *memory,
+        uint lanes, uint segment_blocks)
+{
+    SPECIALIZE_LANES(lanes);
+    SPECIALIZE_SEGMENT_BLOCKS(segment_blocks);
+
+    uint job_id = get_global_id(1);
+    uint index  = get_global_id(0);
+    uint lane   = index % lanes;
+    uint block  = index / lanes;
+
+    uint lane_blocks = ARGON2_SYNC_POINTS * segment_blocks;
+
+    seeds += (size_t)job_id * ARGON2_PREHASH_DIGEST_LENGTH;
+    memory += (size_t)(job_id - get_global_offset(1)) * lanes * lane_blocks
+            + index;
+
+    uchar seed[ARGON2_PREHASH_SEED_LENGTH];
+    for (uint i = 0; i < ARGON2_PREHASH_DIGEST_LENGTH; i++) {
+        seed[i] = seeds[i];
+    }
+    store32_le(seed + ARGON2_PREHASH_DIGEST_LENGTH, block);
+    store32_le(seed + ARGON2_PREHASH_DIGEST_LENGTH + 4, lane);
+
+    blake2b_digest_long((__global uchar *)memory, ARGON2_BLOCK_SIZE,
+                        seed, ARGON2_PREHASH_SEED_LENGTH);
+}
+
+/*
+ * XORs the last blocks of all lanes and hashes the result into the final
+ * tag (out_len bytes per job).
+ * Global size: (batch size); the memory is indexed like in
+ * argon2_init_kernel, the output by the absolute job.
+ */
+__kernel void argon2_finalize_kernel(
+        __global const struct block_g *memory, __global uchar *out,
+        uint lanes, uint segment_blocks, uint out_len)
+{
+    SPECIALIZE_LANES(lanes);
+    SPECIALIZE_SEGMENT_BLOCKS(segment_blocks);
+
+    uint job_id = get_global_id(0);
+
+    uint lane_blocks = ARGON2_SYNC_POINTS * segment_blocks;
+
+    /* the last block of every lane: */
+    memory += (size_t)(job_id - get_global_offset(0)) * lanes * lane_blocks
+            + (size_t)(lane_blocks - 1) * lanes;
+    out += (size_t)job_id * out_len;
+
+    uchar xored[ARGON2_BLOCK_SIZE];
+    for (uint i = 0; i < ARGON2_QWORDS_IN_BLOCK; i++) {
+        ulong value = memory[0].data[i];
+        for (uint l = 1; l < lanes; l++) {
+            value ^= memory[l].data[i];
+        }
+        store64_le(xored + i * 8, value);
+    }
+
+    blake2b_digest_long(out, out_len, xored, ARGON2_BLOCK_SIZE);
+}
+
+#define ARGON2_ANY_TARGET 0xFFFFFFFFU
+
+/* Compares the tags of a batch against the target tags and appends the
+ * (job, target) pair of every match to the list after the match counter
+ * (matches[0]). A job is compared either against the single target given in
+ * job_targets or against all of them; it is reported (at most) once, so the
+ * list never holds more entries than there are jobs. */
+__kernel void argon2_compare_kernel(
+        __global const uchar *tags, __global const uchar *targets,
+        uint target_count, __global const uint *job_targets,
+        __global uint *matches, uint out_len)
+{
+    uint job_id = get_global_id(0);
+
+    uint from = 0, to = target_count;
+    uint target = job_targets[job_id];
+    if (target != ARGON2_ANY_TARGET) {
+        if (target >= target_count) {
+            return;
+        }
+        from = target;
+        to = target + 1;
+    }
+
+    tags += (size_t)job_id * out_len;
+    for (uint t = from; t < to; t++) {
+        __global const uchar *expected = targets + (size_t)t * out_len;
+
+        uint i = 0;
+        while (i < out_len && expected[i] == tags[i]) {
+            i++;
+        }
+        if (i == out_len) {
+            uint slot = atomic_inc(matches);
+            matches[1 + 2 * slot] = job_id;
+            matches[2 + 2 * slot] = t;
+            return;
+        }
+    }
+}
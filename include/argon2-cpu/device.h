@@ -0,0 +1,48 @@
+#ifndef ARGON2_CPU_DEVICE_H
+#define ARGON2_CPU_DEVICE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace argon2 {
+namespace cpu {
+
+/* The host CPU, seen as a single device that runs one job per thread: */
+class Device
+{
+private:
+    std::size_t threadCount;
+
+public:
+    std::string getName() const;
+    std::string getInfo() const;
+
+    /* Physical memory of the host (0 if unknown); there is no limit on a
+     * single allocation below that: */
+    std::uint64_t getGlobalMemorySize() const;
+    std::uint64_t getMaxAllocationSize() const;
+
+    std::size_t getThreadCount() const { return threadCount; }
+
+    /**
+     * @brief Empty constructor.
+     * NOTE: Calling methods other than the destructor on an instance initialized
+     * with empty constructor results in undefined behavior.
+     */
+    Device() : threadCount(0) { }
+
+    Device(std::size_t threadCount) : threadCount(threadCount)
+    {
+    }
+
+    Device(const Device &) = default;
+    Device(Device &&) = default;
+
+    Device &operator=(const Device &) = default;
+};
+
+} // namespace cpu
+} // namespace argon2
+
+#endif // ARGON2_CPU_DEVICE_H
@@ -0,0 +1,25 @@
+#ifndef ARGON2_CPU_GLOBALCONTEXT_H
+#define ARGON2_CPU_GLOBALCONTEXT_H
+
+#include "device.h"
+
+#include <vector>
+
+namespace argon2 {
+namespace cpu {
+
+class GlobalContext
+{
+private:
+    std::vector<Device> devices;
+
+public:
+    const std::vector<Device> &getAllDevices() const { return devices; }
+
+    GlobalContext();
+};
+
+} // namespace cpu
+} // namespace argon2
+
+#endif // ARGON2_CPU_GLOBALCONTEXT_H
@@ -0,0 +1,105 @@
+#ifndef ARGON2_CPU_KERNELRUNNER_H
+#define ARGON2_CPU_KERNELRUNNER_H
+
+#include "programcontext.h"
+#include "argon2-gpu-common/argon2params.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace argon2 {
+namespace cpu {
+
+/* Runs the jobs of a batch on a pool of persistent worker threads. Each
+ * worker takes groups of up to jobsPerGroup consecutive jobs and computes
+ * them in lockstep (the CPU counterpart of the GPU's jobs per block), so
+ * the memory latency of one job hides behind the computation of the others.
+ * Each worker owns one preallocated arena (the memory of the largest group),
+ * so the memory footprint depends on the number of workers, not on the batch
+ * size; only the first and last blocks of every job are kept per job. The
+ * workers use their own copy of those, so the host can prepare the next
+ * batch and read the previous one while a batch runs: */
+class KernelRunner
+{
+private:
+    const ProgramContext *programContext;
+    const Argon2Params *params;
+
+    std::size_t batchSize;
+    std::size_t maxJobsPerGroup;
+    std::size_t jobsPerGroup;
+    int implementation;
+
+    std::unique_ptr<std::uint8_t[]> blocksIn, jobsIn;
+    std::unique_ptr<std::uint8_t[]> blocksOut, jobsOut;
+    std::vector<std::unique_ptr<std::uint8_t[]>> arenas;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable startCond, doneCond;
+    std::size_t generation;
+    std::size_t nextJob;
+    std::size_t pendingJobs;
+    bool running;
+    bool stopping;
+    std::exception_ptr error;
+    std::chrono::steady_clock::time_point start;
+
+    std::size_t getInputSize() const;
+    std::size_t getOutputSize() const;
+
+    void runWorker(std::size_t workerIndex);
+    void runGroup(std::uint8_t *arena, std::size_t firstJob,
+                  std::size_t count);
+
+public:
+    std::size_t getBatchSize() const { return batchSize; }
+    std::size_t getWorkerCount() const { return workers.size(); }
+    std::size_t getMinJobsPerGroup() const { return 1; }
+    std::size_t getMaxJobsPerGroup() const { return maxJobsPerGroup; }
+
+    /* The first two blocks (input) and the last block (output) of every
+     * lane of the given job: */
+    void *getInputMemory(std::size_t jobId) const
+    {
+        return blocksIn.get() + jobId * getInputSize();
+    }
+    const void *getOutputMemory(std::size_t jobId) const
+    {
+        return blocksOut.get() + jobId * getOutputSize();
+    }
+
+    /* The largest batch size for which a runner fits into the host memory
+     * (with some of it left to the rest of the system), counting a
+     * single-job arena per worker and the per-job first and last blocks.
+     * The constructor limits the group size (and if need be the number of
+     * workers) to the arenas that fit. Returns 0 if not even a single job
+     * fits: */
+    static std::size_t getMaxBatchSize(const Argon2Params *params,
+                                       const Device *device);
+
+    KernelRunner(const ProgramContext *programContext,
+                 const Argon2Params *params, const Device *device,
+                 std::size_t batchSize);
+    ~KernelRunner();
+
+    KernelRunner(const KernelRunner &) = delete;
+    KernelRunner &operator=(const KernelRunner &) = delete;
+
+    /* Hands the batch to the workers and returns without waiting: */
+    void run(std::size_t jobsPerGroup);
+    /* Waits until all jobs are done, rethrows the first error of a worker
+     * (if any) and returns the time it took to process the batch (in ms): */
+    float finish();
+};
+
+} // namespace cpu
+} // namespace argon2
+
+#endif // ARGON2_CPU_KERNELRUNNER_H
@@ -0,0 +1,82 @@
+#ifndef ARGON2_CPU_PROCESSINGUNIT_H
+#define ARGON2_CPU_PROCESSINGUNIT_H
+
+#include <memory>
+
+#include "programcontext.h"
+#include "kernelrunner.h"
+#include "argon2-gpu-common/argon2params.h"
+
+namespace argon2 {
+namespace cpu {
+
+class ProcessingUnit
+{
+private:
+    const ProgramContext *programContext;
+    const Argon2Params *params;
+    const Device *device;
+
+    KernelRunner runner;
+    std::size_t bestJobsPerGroup;
+
+public:
+    std::size_t getBatchSize() const { return runner.getBatchSize(); }
+
+    /* bySegment and precomputeRefs only exist for compatibility with the
+     * GPU backends; the CPU always computes the references on the fly: */
+    ProcessingUnit(
+            const ProgramContext *programContext, const Argon2Params *params,
+            const Device *device, std::size_t batchSize,
+            bool bySegment = true, bool precomputeRefs = false);
+
+    /* The largest batch size that a unit constructed with the same
+     * arguments can be given without running out of host memory (0 if not
+     * even a single job fits); larger workloads should be split into
+     * several batches on one unit: */
+    static std::size_t getMaxBatchSize(
+            const ProgramContext *programContext, const Argon2Params *params,
+            const Device *device, bool bySegment = true,
+            bool precomputeRefs = false)
+    {
+        (void)programContext;
+        (void)bySegment;
+        (void)precomputeRefs;
+        return KernelRunner::getMaxBatchSize(params, device);
+    }
+
+    /* You can safely call this function after the beginProcessing() call to
+     * prepare the next batch: */
+    void setPassword(std::size_t index, const void *pw, std::size_t pwSize);
+    /* You can safely call this function after the beginProcessing() call to
+     * process the previous batch: */
+    void getHash(std::size_t index, void *hash);
+
+    /* Same as above, but the salt, secret, associated data and output length
+     * are taken from jobParams instead of the unit's params. This allows
+     * mixing jobs with different salts in one batch. The cost parameters
+     * (time cost, memory cost, lanes) of jobParams must match the unit's: */
+    void setPassword(std::size_t index, const Argon2Params &jobParams,
+                     const void *pw, std::size_t pwSize);
+    void getHash(std::size_t index, const Argon2Params &jobParams,
+                 void *hash);
+
+    /* Batch versions of the above for the jobs [begin, end): job begin + i
+     * takes the password pws[i] (pwSizes[i] bytes) and its tag is written
+     * to hashes[i]; with jobParams, it uses *jobParams[i] like the overloads
+     * above. The work is spread across the host ThreadPool and goes directly
+     * to (or from) the runner's staging memory: */
+    void setPasswords(std::size_t begin, std::size_t end,
+                      const void *const *pws, const std::size_t *pwSizes,
+                      const Argon2Params *const *jobParams = nullptr);
+    void getHashes(std::size_t begin, std::size_t end, void *const *hashes,
+                   const Argon2Params *const *jobParams = nullptr);
+
+    void beginProcessing();
+    void endProcessing();
+};
+
+} // namespace cpu
+} // namespace argon2
+
+#endif // ARGON2_CPU_PROCESSINGUNIT_H
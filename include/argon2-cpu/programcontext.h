@@ -0,0 +1,33 @@
+#ifndef ARGON2_CPU_PROGRAMCONTEXT_H
+#define ARGON2_CPU_PROGRAMCONTEXT_H
+
+#include "globalcontext.h"
+#include "argon2-gpu-common/argon2-common.h"
+
+namespace argon2 {
+namespace cpu {
+
+class ProgramContext
+{
+private:
+    const GlobalContext *globalContext;
+
+    Type type;
+    Version version;
+
+public:
+    const GlobalContext *getGlobalContext() const { return globalContext; }
+
+    Type getArgon2Type() const { return type; }
+    Version getArgon2Version() const { return version; }
+
+    ProgramContext(
+            const GlobalContext *globalContext,
+            const std::vector<Device> &devices,
+            Type type, Version version);
+};
+
+} // namespace cpu
+} // namespace argon2
+
+#endif // ARGON2_CPU_PROGRAMCONTEXT_H
@@ -18,6 +18,7 @@
 #ifndef ARGON2_CUDA_DEVICE_H
 #define ARGON2_CUDA_DEVICE_H
 
+#include <cstdint>
 #include <string>
 
 namespace argon2 {
@@ -34,6 +35,11 @@ public:
     std::string getName() const;
     std::string getInfo() const;
 
+    /* Total global memory of the device and the largest single buffer that
+     * can be allocated on it, in bytes: */
+    std::uint64_t getGlobalMemorySize() const;
+    std::uint64_t getMaxAllocationSize() const;
+
     int getDeviceIndex() const { return deviceIndex; }
 
     /**
@@ -61,6 +67,9 @@ public:
     std::string getName() const { return {}; }
     std::string getInfo() const { return {}; }
 
+    std::uint64_t getGlobalMemorySize() const { return 0; }
+    std::uint64_t getMaxAllocationSize() const { return 0; }
+
     int getDeviceIndex() const { return 0; }
 
     Device() { }
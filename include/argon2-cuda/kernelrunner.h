@@ -52,6 +52,16 @@ public:
 
     std::size_t getBatchSize() const { return batchSize; }
 
+    /* The largest batch size for which a runner with the given
+     * configuration fits into the free memory of the current device, with
+     * some of it left to the driver and other processes. Returns 0 if not
+     * even a single job fits: */
+    static std::size_t getMaxBatchSize(std::uint32_t type,
+                                       std::uint32_t passes,
+                                       std::uint32_t lanes,
+                                       std::uint32_t segmentBlocks,
+                                       bool precompute);
+
     KernelRunner(std::uint32_t type, std::uint32_t version,
                  std::uint32_t passes, std::uint32_t lanes,
                  std::uint32_t segmentBlocks, std::size_t batchSize,
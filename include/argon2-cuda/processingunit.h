@@ -26,11 +26,24 @@ private:
 public:
     std::size_t getBatchSize() const { return runner.getBatchSize(); }
 
+    /* The launch configuration picked by the autotuning: */
+    std::uint32_t getBestLanesPerBlock() const { return bestLanesPerBlock; }
+    std::size_t getBestJobsPerBlock() const { return bestJobsPerBlock; }
+
     ProcessingUnit(
             const ProgramContext *programContext, const Argon2Params *params,
             const Device *device, std::size_t batchSize,
             bool bySegment = true, bool precomputeRefs = false);
 
+    /* The largest batch size that a unit constructed with the same
+     * arguments can be given without running out of device memory (0 if
+     * not even a single job fits); larger workloads should be split into
+     * several batches on one unit: */
+    static std::size_t getMaxBatchSize(
+            const ProgramContext *programContext, const Argon2Params *params,
+            const Device *device, bool bySegment = true,
+            bool precomputeRefs = false);
+
     /* You can safely call this function after the beginProcessing() call to
      * prepare the next batch: */
     void setPassword(std::size_t index, const void *pw, std::size_t pwSize);
@@ -38,6 +51,26 @@ public:
      * process the previous batch: */
     void getHash(std::size_t index, void *hash);
 
+    /* Same as above, but the salt, secret, associated data and output length
+     * are taken from jobParams instead of the unit's params. This allows
+     * mixing jobs with different salts in one batch. The cost parameters
+     * (time cost, memory cost, lanes) of jobParams must match the unit's: */
+    void setPassword(std::size_t index, const Argon2Params &jobParams,
+                     const void *pw, std::size_t pwSize);
+    void getHash(std::size_t index, const Argon2Params &jobParams,
+                 void *hash);
+
+    /* Batch versions of the above for the jobs [begin, end): job begin + i
+     * takes the password pws[i] (pwSizes[i] bytes) and its tag is written
+     * to hashes[i]; with jobParams, it uses *jobParams[i] like the overloads
+     * above. The work is spread across the host ThreadPool and goes directly
+     * to (or from) the runner's staging memory: */
+    void setPasswords(std::size_t begin, std::size_t end,
+                      const void *const *pws, const std::size_t *pwSizes,
+                      const Argon2Params *const *jobParams = nullptr);
+    void getHashes(std::size_t begin, std::size_t end, void *const *hashes,
+                   const Argon2Params *const *jobParams = nullptr);
+
     void beginProcessing();
     void endProcessing();
 };
@@ -60,6 +93,9 @@ class ProcessingUnit
 public:
     std::size_t getBatchSize() const { return 0; }
 
+    std::uint32_t getBestLanesPerBlock() const { return 0; }
+    std::size_t getBestJobsPerBlock() const { return 0; }
+
     ProcessingUnit(
             const ProgramContext *programContext, const Argon2Params *params,
             const Device *device, std::size_t batchSize,
@@ -67,10 +103,29 @@ public:
     {
     }
 
+    static std::size_t getMaxBatchSize(
+            const ProgramContext *programContext, const Argon2Params *params,
+            const Device *device, bool bySegment = true,
+            bool precomputeRefs = false)
+    {
+        return 0;
+    }
+
     void setPassword(std::size_t index, const void *pw, std::size_t pwSize) { }
 
     void getHash(std::size_t index, void *hash) { }
 
+    void setPassword(std::size_t index, const Argon2Params &jobParams,
+                     const void *pw, std::size_t pwSize) { }
+    void getHash(std::size_t index, const Argon2Params &jobParams,
+                 void *hash) { }
+
+    void setPasswords(std::size_t begin, std::size_t end,
+                      const void *const *pws, const std::size_t *pwSizes,
+                      const Argon2Params *const *jobParams = nullptr) { }
+    void getHashes(std::size_t begin, std::size_t end, void *const *hashes,
+                   const Argon2Params *const *jobParams = nullptr) { }
+
     void beginProcessing() { }
     void endProcessing() { }
 };
@@ -18,9 +18,9 @@ private:
 
     static void digestLong(void *out, std::size_t outLen,
                            const void *in, std::size_t inLen);
-
-    void initialHash(void *out, const void *pwd, std::size_t pwdLen,
-                     Type type, Version version) const;
+    static void digestLong(void *const *outs, std::size_t outLen,
+                           const void *const *ins, std::size_t inLen,
+                           std::size_t count);
 
 public:
     std::uint32_t getOutputLength() const { return outLen; }
@@ -54,10 +54,32 @@ public:
             const void *ad, std::size_t adLen,
             std::size_t t_cost, std::size_t m_cost, std::size_t lanes);
 
+    /* Computes the initial hash H0 (ARGON2_PREHASH_DIGEST_LENGTH bytes),
+     * which is all the device needs to generate the first blocks itself: */
+    void initialHash(void *out, const void *pwd, std::size_t pwdLen,
+                     Type type, Version version) const;
+
     void fillFirstBlocks(void *memory, const void *pwd, std::size_t pwdLen,
                          Type type, Version version) const;
 
     void finalize(void *out, const void *memory) const;
+
+    /* Batch versions of the above for count jobs. The Blake2b hashes of
+     * several jobs are computed at once with SIMD where the CPU supports it
+     * (see Blake2b::hashMany()): */
+    void fillFirstBlocks(void *const *memories, const void *const *pwds,
+                         const std::size_t *pwdLens, std::size_t count,
+                         Type type, Version version) const;
+
+    /* Same as above, but starts from the initial hashes of the jobs (see
+     * initialHash()). Only the lanes are taken from these params, so the
+     * jobs may use different salts, secrets or associated data: */
+    void fillFirstBlocks(void *const *memories,
+                         const void *const *initialHashes,
+                         std::size_t count) const;
+
+    void finalize(void *const *outs, const void *const *memories,
+                  std::size_t count) const;
 };
 
 } // namespace argon2
@@ -0,0 +1,32 @@
+#ifndef ARGON2_HOSTBATCH_H
+#define ARGON2_HOSTBATCH_H
+
+#include <cstddef>
+
+#include "argon2params.h"
+
+namespace argon2 {
+
+/* The host side of a whole batch, split across the ThreadPool and computed
+ * with the batch (multi-buffer) versions of the Argon2Params functions.
+ * Job i uses *jobParams[i], or params if jobParams is null; all of them must
+ * share the lanes of params. */
+
+/* Writes the first blocks of each job (or, with initialHashOnly, just its
+ * initial hash H0) to memories[i]: */
+void fillInputs(const Argon2Params &params,
+                const Argon2Params *const *jobParams,
+                void *const *memories, const void *const *pws,
+                const std::size_t *pwSizes, std::size_t count,
+                Type type, Version version, bool initialHashOnly);
+
+/* Writes the tag of each job to hashes[i], computed from its last blocks in
+ * memories[i] (or, with tagsOnly, copied from memories[i]): */
+void readOutputs(const Argon2Params &params,
+                 const Argon2Params *const *jobParams,
+                 void *const *hashes, const void *const *memories,
+                 std::size_t count, bool tagsOnly);
+
+} // namespace argon2
+
+#endif // ARGON2_HOSTBATCH_H
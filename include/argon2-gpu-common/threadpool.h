@@ -0,0 +1,65 @@
+#ifndef ARGON2_THREADPOOL_H
+#define ARGON2_THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace argon2 {
+
+/* A process-wide pool of host threads for the CPU side of the batches (the
+ * first blocks and the final tags). Several units (e.g. one per device) may
+ * use it at once; their tasks are served in order: */
+class ThreadPool
+{
+public:
+    typedef std::function<void(std::size_t begin, std::size_t end)> Body;
+
+private:
+    struct Task
+    {
+        const Body *body;
+        std::size_t count;
+        std::size_t chunkSize;
+        std::size_t next;
+        std::size_t pendingChunks;
+        std::exception_ptr error;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable startCond, doneCond;
+    std::deque<Task *> tasks;
+    bool stopping;
+
+    ThreadPool();
+    ~ThreadPool();
+
+    /* Runs one chunk of the task; must be called with the lock held, which
+     * is released while the chunk runs: */
+    void runChunk(std::unique_lock<std::mutex> &lock, Task &task);
+    void runWorker();
+
+public:
+    static ThreadPool &instance();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    std::size_t getThreadCount() const { return workers.size() + 1; }
+
+    /* Calls body on the chunks [begin, end) of [0, count), each at most
+     * chunkSize long, from the pool's threads and the calling one. Returns
+     * when all chunks are done and rethrows the first error of a chunk (if
+     * any): */
+    void run(std::size_t count, std::size_t chunkSize, const Body &body);
+};
+
+} // namespace argon2
+
+#endif // ARGON2_THREADPOOL_H
@@ -0,0 +1,70 @@
+#ifndef ARGON2_TUNINGCACHE_H
+#define ARGON2_TUNINGCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "argon2params.h"
+
+namespace argon2 {
+
+/* The launch configuration picked by a ProcessingUnit's timing sweep (the
+ * CPU backend only uses jobsPerBlock, as its jobs per group): */
+struct TuningResult
+{
+    std::uint32_t lanesPerBlock;
+    std::size_t jobsPerBlock;
+};
+
+/* A process-wide, persistent cache of the tuning results, so that the
+ * processing units only run their timing sweeps once per device and
+ * configuration instead of on every construction. The results are kept in
+ * "tuning.txt" (one "KEY<TAB>LANES JOBS" line per entry) in the same
+ * directory as the OpenCL program cache. Entries stored by other processes
+ * are merged in whenever an entry is stored: */
+class TuningCache
+{
+private:
+    std::mutex mutex;
+    std::string path;
+    bool retune;
+    bool loaded;
+    std::map<std::string, TuningResult> entries;
+
+    TuningCache();
+
+    void load(std::map<std::string, TuningResult> &into) const;
+
+public:
+    static TuningCache &instance();
+
+    TuningCache(const TuningCache &) = delete;
+    TuningCache &operator=(const TuningCache &) = delete;
+
+    /* The key of a configuration; mode describes the kernel variant (e.g.
+     * "by-segment,precompute"): */
+    static std::string makeKey(const std::string &backend,
+                               const std::string &deviceName,
+                               const Argon2Params &params,
+                               Type type, Version version,
+                               std::size_t batchSize,
+                               const std::string &mode);
+
+    /* An empty path disables the cache (nothing is read or written): */
+    void setPath(const std::string &path);
+    std::string getPath();
+
+    /* With retune, lookup() always misses, so every configuration is tuned
+     * again (and stored, replacing the old result): */
+    void setRetune(bool retune);
+
+    bool lookup(const std::string &key, TuningResult &result);
+    void store(const std::string &key, const TuningResult &result);
+};
+
+} // namespace argon2
+
+#endif // ARGON2_TUNINGCACHE_H
@@ -32,6 +32,15 @@ public:
     std::string getName() const;
     std::string getInfo() const;
 
+    /* Total global memory of the device and the largest single buffer that
+     * can be allocated on it, in bytes: */
+    std::uint64_t getGlobalMemorySize() const;
+    std::uint64_t getMaxAllocationSize() const;
+
+    /* Whether the device shares the memory of the host (e.g. a CPU device),
+     * so that the host can work on mapped buffers without copies: */
+    bool hasHostUnifiedMemory() const;
+
     const cl::Device &getCLDevice() const { return device; }
 
     /**
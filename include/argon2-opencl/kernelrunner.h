@@ -4,36 +4,111 @@
 #include "programcontext.h"
 #include "argon2-gpu-common/argon2params.h"
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 namespace argon2 {
 namespace opencl {
 
+/* Job target index meaning "compare against all targets": */
+const std::uint32_t ANY_TARGET = 0xFFFFFFFF;
+
 class KernelRunner
 {
 private:
+    /* One set of device memory and host staging areas; with more than one
+     * set, the host can work on one batch while another is being processed
+     * on the device: */
+    struct BufferSet
+    {
+        /* The job memory, split into buffers of jobsPerMemoryBuffer jobs
+         * (the last one may hold fewer), so that a batch is not limited by
+         * the maximum allocation size of the device: */
+        std::vector<cl::Buffer> memoryBuffers;
+        cl::Event start, end, kernelStart, kernelEnd;
+
+        /* Host staging areas, allocated by the runtime as pinned/DMA-able
+         * memory and kept mapped for the lifetime of the runner. With
+         * zeroCopy there are none: with deviceInitFinalize these point into
+         * the mapped seeds and tags, otherwise the host works on the mapped
+         * job memory (mappedMemory, one address per memory buffer): */
+        cl::Buffer stagingIn, stagingOut;
+        std::uint8_t *blocksIn = nullptr;
+        std::uint8_t *blocksOut = nullptr;
+        std::vector<std::uint8_t *> mappedMemory;
+
+        /* Device-side initial hashes and tags (deviceInitFinalize only): */
+        cl::Buffer seedsBuffer, tagsBuffer;
+
+        /* Device-side comparison (only when targets are set); the targets
+         * are re-uploaded only when they change: */
+        cl::Buffer targetsBuffer, jobTargetsBuffer, matchesBuffer;
+        std::size_t targetsCapacity = 0;
+        std::size_t targetsVersion = 0;
+        std::vector<cl_uint> jobTargets;
+        cl_uint matchCount = 0;
+        bool compared = false;
+    };
+
     const ProgramContext *programContext;
     const Argon2Params *params;
 
     std::size_t batchSize;
+    std::size_t jobsPerMemoryBuffer;
     bool bySegment;
     bool precompute;
-
-    cl::CommandQueue queue;
-    cl::Kernel kernel;
-    cl::Buffer memoryBuffer, refsBuffer;
-    cl::Event start, end, kernelStart, kernelEnd;
-
-    std::size_t memorySize;
-
-    std::unique_ptr<std::uint8_t[]> blocksIn;
-    std::unique_ptr<std::uint8_t[]> blocksOut;
-
-    void copyInputBlocks();
-    void copyOutputBlocks();
+    bool deviceInitFinalize;
+
+    /* On host-unified devices the host fills the first blocks and reads the
+     * last blocks (or the seeds and tags) in the device buffers themselves,
+     * which are mapped between runs and unmapped while the kernels run: */
+    bool zeroCopy;
+
+    /* Uploads, kernels and downloads go to separate in-order queues, so the
+     * transfers of one buffer set overlap with the kernels of another: */
+    cl::CommandQueue uploadQueue, queue, downloadQueue;
+    cl::Kernel kernel, initKernel, finalizeKernel, compareKernel;
+    cl::Buffer refsBuffer;
+    std::vector<BufferSet> buffers;
+
+    std::vector<std::uint8_t> targets;
+    std::size_t targetCount;
+    std::size_t targetsVersion;
+
+    std::size_t getInputSize() const;
+    std::size_t getOutputSize() const;
+
+    void copyInputBlocks(BufferSet &set);
+    void copyOutputBlocks(BufferSet &set);
+    void copyTargets(BufferSet &set);
+
+    void mapBuffers(BufferSet &set, const std::vector<cl::Event> *waitList,
+                    cl::Event *event);
+    void unmapBuffers(BufferSet &set, cl::CommandQueue &queue,
+                      const std::vector<cl::Event> *waitList,
+                      cl::Event *event);
+
+    /* The (mapped) memory of the given job, with zeroCopy: */
+    std::uint8_t *getJobMemory(std::size_t buffer, std::size_t jobId) const
+    {
+        return buffers[buffer].mappedMemory[jobId / jobsPerMemoryBuffer]
+                + (jobId % jobsPerMemoryBuffer) * params->getMemorySize();
+    }
 
     void precomputeRefs();
 
+    /* The first job and the number of jobs of the given memory buffer: */
+    std::size_t getFirstJob(std::size_t memoryBuffer) const
+    {
+        return memoryBuffer * jobsPerMemoryBuffer;
+    }
+    std::size_t getJobCount(std::size_t memoryBuffer) const
+    {
+        return std::min(jobsPerMemoryBuffer,
+                        batchSize - getFirstJob(memoryBuffer));
+    }
+
 public:
     std::uint32_t getMinLanesPerBlock() const
     {
@@ -42,27 +117,112 @@ public:
     std::uint32_t getMaxLanesPerBlock() const { return params->getLanes(); }
 
     std::size_t getMinJobsPerBlock() const { return 1; }
-    std::size_t getMaxJobsPerBlock() const { return batchSize; }
+    /* A block never spans two memory buffers, so the jobs per block must
+     * also divide the jobs per memory buffer: */
+    std::size_t getMaxJobsPerBlock() const { return jobsPerMemoryBuffer; }
 
     std::size_t getBatchSize() const { return batchSize; }
+    std::size_t getJobsPerMemoryBuffer() const { return jobsPerMemoryBuffer; }
+    std::size_t getBufferCount() const { return buffers.size(); }
+    bool isDeviceInitFinalize() const { return deviceInitFinalize; }
+    bool isZeroCopy() const { return zeroCopy; }
+
+    /* Per-job input/output staging areas. Normally these hold the first
+     * two blocks and the last block of every lane; with deviceInitFinalize
+     * they hold the initial hash (H0) and the final tag instead. With
+     * zeroCopy they are the device memory itself, so the input of a buffer
+     * set may only be written once its last run has finished (see
+     * waitForInput()), and its output is overwritten by its next run: */
+    void *getInputMemory(std::size_t buffer, std::size_t jobId) const
+    {
+        if (zeroCopy && !deviceInitFinalize) {
+            return getJobMemory(buffer, jobId);
+        }
+        return buffers[buffer].blocksIn + jobId * getInputSize();
+    }
+    const void *getOutputMemory(std::size_t buffer, std::size_t jobId) const
+    {
+        if (zeroCopy && !deviceInitFinalize) {
+            return getJobMemory(buffer, jobId)
+                    + params->getMemorySize() - getOutputSize();
+        }
+        return buffers[buffer].blocksOut + jobId * getOutputSize();
+    }
+
+    /* Sets the target tags (count * output length bytes) that the tags of
+     * every following run are compared against on the device; only the
+     * matches are then read back instead of the tags. A count of zero turns
+     * comparing off. Requires deviceInitFinalize: */
+    void setTargets(const void *tags, std::size_t count);
+    std::size_t getTargetCount() const { return targetCount; }
+
+    /* Restricts the comparison of the given job to a single target
+     * (ANY_TARGET, the default, compares it against all of them): */
+    void setJobTarget(std::size_t buffer, std::size_t jobId,
+                      std::uint32_t targetIndex)
+    {
+        buffers[buffer].jobTargets[jobId] = targetIndex;
+    }
+
+    /* Whether the last run of the given buffer set compared the tags on the
+     * device, how many jobs matched and the (job, target) index pairs of the
+     * matches, in no particular order (only valid after finish()): */
+    bool isCompared(std::size_t buffer) const
+    {
+        return buffers[buffer].compared;
+    }
+    std::size_t getMatchCount(std::size_t buffer) const
+    {
+        return buffers[buffer].matchCount;
+    }
+    void readMatches(std::size_t buffer, cl_uint *pairs);
 
     void *getInputMemory(std::size_t jobId) const
     {
-        std::size_t copySize = params->getLanes() * 2 * ARGON2_BLOCK_SIZE;
-        return blocksIn.get() + jobId * copySize;
+        return getInputMemory(0, jobId);
     }
     const void *getOutputMemory(std::size_t jobId) const
     {
-        std::size_t copySize = params->getLanes() * ARGON2_BLOCK_SIZE;
-        return blocksOut.get() + jobId * copySize;
+        return getOutputMemory(0, jobId);
     }
 
+    /* The largest batch size for which a runner with the given
+     * configuration fits on the device: all buffers (plus the refs) have to
+     * fit into the global memory, with some of it left to the driver and
+     * other processes. Returns 0 if not even a single job fits (a job's
+     * memory cannot be split across allocations): */
+    static std::size_t getMaxBatchSize(
+            const ProgramContext *programContext, const Argon2Params *params,
+            const Device *device, bool precompute,
+            std::size_t bufferCount = 1, bool deviceInitFinalize = false);
+
     KernelRunner(const ProgramContext *programContext,
                  const Argon2Params *params, const Device *device,
-                 std::size_t batchSize, bool bySegment, bool precompute);
-
-    void run(std::uint32_t lanesPerBlock, std::size_t jobsPerBlock);
-    float finish();
+                 std::size_t batchSize, bool bySegment, bool precompute,
+                 std::size_t bufferCount = 1,
+                 bool deviceInitFinalize = false);
+    ~KernelRunner();
+
+    KernelRunner(const KernelRunner &) = delete;
+    KernelRunner &operator=(const KernelRunner &) = delete;
+
+    /* Enqueues the upload, kernels and download for the given buffer set
+     * and returns without waiting for any of them: */
+    void run(std::size_t buffer,
+             std::uint32_t lanesPerBlock, std::size_t jobsPerBlock);
+    /* Waits until the input blocks of the given buffer set have been
+     * uploaded (with zeroCopy, until its run has finished), so they can be
+     * overwritten with the next batch: */
+    void waitForInput(std::size_t buffer);
+    /* Waits until the output blocks of the given buffer set are available
+     * and returns the time it took to process it (in ms): */
+    float finish(std::size_t buffer);
+
+    void run(std::uint32_t lanesPerBlock, std::size_t jobsPerBlock)
+    {
+        run(0, lanesPerBlock, jobsPerBlock);
+    }
+    float finish() { return finish(0); }
 };
 
 } // namespace opencl
@@ -1,13 +1,22 @@
 #ifndef ARGON2_OPENCL_PROCESSINGUNIT_H
 #define ARGON2_OPENCL_PROCESSINGUNIT_H
 
+#include <deque>
 #include <memory>
+#include <vector>
 
 #include "kernelrunner.h"
 
 namespace argon2 {
 namespace opencl {
 
+/* A job whose tag matched a target in the device comparison: */
+struct Match
+{
+    std::size_t jobId;
+    std::size_t targetIndex;
+};
+
 class ProcessingUnit
 {
 private:
@@ -19,21 +28,109 @@ private:
     std::uint32_t bestLanesPerBlock;
     std::size_t bestJobsPerBlock;
 
+    /* The buffer set setPassword() writes to, the one getHash() reads from
+     * and the ones currently being processed (oldest first): */
+    std::size_t inputBuffer;
+    std::size_t outputBuffer;
+    std::deque<std::size_t> pendingBuffers;
+
+    void fillInput(void *memory, const Argon2Params &jobParams,
+                   const void *pw, std::size_t pwSize) const;
+    void readOutput(void *hash, const Argon2Params &jobParams,
+                    const void *memory) const;
+    void fillInputs(std::size_t buffer, std::size_t begin, std::size_t end,
+                    const void *const *pws, const std::size_t *pwSizes,
+                    const Argon2Params *const *jobParams) const;
+
 public:
     std::size_t getBatchSize() const { return runner.getBatchSize(); }
+    std::size_t getBufferCount() const { return runner.getBufferCount(); }
+
+    /* The launch configuration picked by the autotuning: */
+    std::uint32_t getBestLanesPerBlock() const { return bestLanesPerBlock; }
+    std::size_t getBestJobsPerBlock() const { return bestJobsPerBlock; }
 
+    /* With bufferCount > 1 the unit is pipelined: every beginProcessing()
+     * launches the current batch and switches setPassword() to the next
+     * buffer set, and every endProcessing() waits for the oldest batch in
+     * flight and switches getHash() to its results. This lets the host
+     * prepare batch N+1 and read back batch N-1 while batch N runs, e.g.:
+     *
+     *   (fill batch 0) begin
+     *   loop: (fill batch N+1) end begin (read batch N)
+     *
+     * Each buffer set takes its own batch-sized device memory. On
+     * host-unified devices the host works on that memory itself (no
+     * copies), so filling a buffer set waits until its last batch is done.
+     *
+     * With deviceInitFinalize, the host only computes the initial hash (H0)
+     * of each password; the first blocks and the final tag are computed on
+     * the device, so only 64 bytes per job are uploaded and only the tags
+     * are read back. All jobs then must share the unit's output length. */
     ProcessingUnit(
             const ProgramContext *programContext, const Argon2Params *params,
             const Device *device, std::size_t batchSize,
-            bool bySegment = true, bool precomputeRefs = false);
+            bool bySegment = true, bool precomputeRefs = false,
+            std::size_t bufferCount = 1, bool deviceInitFinalize = false);
+
+    /* The largest batch size that a unit constructed with the same
+     * arguments can be given without running out of device memory (0 if
+     * not even a single job fits); larger workloads should be split into
+     * several batches on one unit: */
+    static std::size_t getMaxBatchSize(
+            const ProgramContext *programContext, const Argon2Params *params,
+            const Device *device, bool bySegment = true,
+            bool precomputeRefs = false, std::size_t bufferCount = 1,
+            bool deviceInitFinalize = false)
+    {
+        (void)bySegment;
+        return KernelRunner::getMaxBatchSize(programContext, params, device,
+                                             precomputeRefs, bufferCount,
+                                             deviceInitFinalize);
+    }
 
     /* You can safely call this function after the beginProcessing() call to
      * prepare the next batch: */
     void setPassword(std::size_t index, const void *pw, std::size_t pwSize);
     /* You can safely call this function after the beginProcessing() call to
-     * process the previous batch: */
+     * process the previous batch (on host-unified devices, where the unit
+     * works on the device memory itself, only if it ran in another buffer
+     * set): */
     void getHash(std::size_t index, void *hash);
 
+    /* Same as above, but the salt, secret, associated data and output length
+     * are taken from jobParams instead of the unit's params. This allows
+     * mixing jobs with different salts in one batch. The cost parameters
+     * (time cost, memory cost, lanes) of jobParams must match the unit's: */
+    void setPassword(std::size_t index, const Argon2Params &jobParams,
+                     const void *pw, std::size_t pwSize);
+    void getHash(std::size_t index, const Argon2Params &jobParams,
+                 void *hash);
+
+    /* Batch versions of the above for the jobs [begin, end): job begin + i
+     * takes the password pws[i] (pwSizes[i] bytes) and its tag is written
+     * to hashes[i]; with jobParams, it uses *jobParams[i] like the overloads
+     * above. The work is spread across the host ThreadPool and goes directly
+     * to (or from) the runner's staging memory (on host-unified devices,
+     * the device memory itself): */
+    void setPasswords(std::size_t begin, std::size_t end,
+                      const void *const *pws, const std::size_t *pwSizes,
+                      const Argon2Params *const *jobParams = nullptr);
+    void getHashes(std::size_t begin, std::size_t end, void *const *hashes,
+                   const Argon2Params *const *jobParams = nullptr);
+
+    /* With deviceInitFinalize, the tags can also be compared on the device
+     * instead of being read back: setTargets() takes the target tags
+     * (count * output length bytes, uploaded once per change) used by all
+     * following batches and getMatches() returns the jobs of the last
+     * finished batch that matched one of them. By default every job is
+     * compared against all targets; setTarget() restricts a job to a single
+     * one. getHash() is not available while comparing; call
+     * setTargets(nullptr, 0) to switch back to reading the tags. */
+    void setTargets(const void *tags, std::size_t count);
+    void setTarget(std::size_t index, std::uint32_t targetIndex);
+    std::vector<Match> getMatches();
+
     void beginProcessing();
     void endProcessing();
 };
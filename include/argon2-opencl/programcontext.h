@@ -3,6 +3,7 @@
 
 #include "globalcontext.h"
 #include "argon2-gpu-common/argon2-common.h"
+#include "argon2-gpu-common/argon2params.h"
 
 namespace argon2 {
 namespace opencl {
@@ -19,6 +20,9 @@ private:
     Type type;
     Version version;
 
+    bool specialized;
+    std::uint32_t passes, lanes, segmentBlocks;
+
 public:
     const GlobalContext *getGlobalContext() const { return globalContext; }
 
@@ -29,10 +33,27 @@ public:
     Type getArgon2Type() const { return type; }
     Version getArgon2Version() const { return version; }
 
+    /* Whether the program can run jobs with the given cost parameters
+     * (always true for a program that is not specialized): */
+    bool isSpecialized() const { return specialized; }
+    bool canRun(const Argon2Params &params) const
+    {
+        return !specialized || (params.getTimeCost() == passes
+                                && params.getLanes() == lanes
+                                && params.getSegmentBlocks() == segmentBlocks);
+    }
+
     ProgramContext(
             const GlobalContext *globalContext,
             const std::vector<Device> &devices,
             Type type, Version version);
+
+    /* Builds a program specialized for the cost parameters (time cost,
+     * lanes and memory cost) of params; see KernelLoader: */
+    ProgramContext(
+            const GlobalContext *globalContext,
+            const std::vector<Device> &devices,
+            Type type, Version version, const Argon2Params &params);
 };
 
 } // namespace opencl
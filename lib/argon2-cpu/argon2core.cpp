@@ -0,0 +1,306 @@
+#include "argon2core.h"
+#include "blockfill.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace argon2 {
+namespace cpu {
+
+static inline std::uint64_t rotr64(std::uint64_t x, unsigned n)
+{
+    return (x >> n) | (x << (64 - n));
+}
+
+static inline std::uint64_t fBlaMka(std::uint64_t x, std::uint64_t y)
+{
+    const std::uint64_t m = 0xFFFFFFFF;
+    return x + y + 2 * ((x & m) * (y & m));
+}
+
+#define G(a, b, c, d) \
+    do { \
+        a = fBlaMka(a, b); d = rotr64(d ^ a, 32); \
+        c = fBlaMka(c, d); b = rotr64(b ^ c, 24); \
+        a = fBlaMka(a, b); d = rotr64(d ^ a, 16); \
+        c = fBlaMka(c, d); b = rotr64(b ^ c, 63); \
+    } while (0)
+
+#define BLAKE2_ROUND_NOMSG(v0, v1, v2, v3, v4, v5, v6, v7, \
+                           v8, v9, v10, v11, v12, v13, v14, v15) \
+    do { \
+        G(v0, v4, v8, v12); \
+        G(v1, v5, v9, v13); \
+        G(v2, v6, v10, v14); \
+        G(v3, v7, v11, v15); \
+        G(v0, v5, v10, v15); \
+        G(v1, v6, v11, v12); \
+        G(v2, v7, v8, v13); \
+        G(v3, v4, v9, v14); \
+    } while (0)
+
+void fillBlockPortable(const Block &prev, const Block &ref, Block &next,
+                       bool withXor)
+{
+    Block r, tmp;
+    for (std::size_t i = 0; i < ARGON2_QWORDS_IN_BLOCK; i++) {
+        r.v[i] = prev.v[i] ^ ref.v[i];
+        tmp.v[i] = withXor ? r.v[i] ^ next.v[i] : r.v[i];
+    }
+
+    /* rows: */
+    for (std::size_t i = 0; i < 8; i++) {
+        std::uint64_t *v = r.v + 16 * i;
+        BLAKE2_ROUND_NOMSG(
+                v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7],
+                v[8], v[9], v[10], v[11], v[12], v[13], v[14], v[15]);
+    }
+
+    /* columns: */
+    for (std::size_t i = 0; i < 8; i++) {
+        std::uint64_t *v = r.v + 2 * i;
+        BLAKE2_ROUND_NOMSG(
+                v[0], v[1], v[16], v[17], v[32], v[33], v[48], v[49],
+                v[64], v[65], v[80], v[81], v[96], v[97], v[112], v[113]);
+    }
+
+    for (std::size_t i = 0; i < ARGON2_QWORDS_IN_BLOCK; i++) {
+        next.v[i] = tmp.v[i] ^ r.v[i];
+    }
+}
+
+#undef BLAKE2_ROUND_NOMSG
+#undef G
+
+typedef void (*FillBlockFunction)(const Block &prev, const Block &ref,
+                                  Block &next, bool withXor);
+
+static const char *const IMPL_NAMES[] = {
+    "portable", "sse4.1", "avx2", "avx512f",
+};
+
+static FillBlockFunction getFillBlock(Implementation impl)
+{
+    switch (impl) {
+#ifdef ARGON2_CPU_X86_SIMD
+    case IMPL_SSE41:
+        return fillBlockSse41;
+    case IMPL_AVX2:
+        return fillBlockAvx2;
+    case IMPL_AVX512F:
+        return fillBlockAvx512f;
+#endif
+    default:
+        return fillBlockPortable;
+    }
+}
+
+static Implementation detectImplementation()
+{
+    Implementation best = IMPL_PORTABLE;
+#ifdef ARGON2_CPU_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        best = IMPL_AVX512F;
+    } else if (__builtin_cpu_supports("avx2")) {
+        best = IMPL_AVX2;
+    } else if (__builtin_cpu_supports("sse4.1")) {
+        best = IMPL_SSE41;
+    }
+#endif
+
+    const char *requested = std::getenv("ARGON2_CPU_IMPL");
+    if (requested != nullptr) {
+        for (int impl = IMPL_PORTABLE; impl <= best; impl++) {
+            if (std::strcmp(requested, IMPL_NAMES[impl]) == 0) {
+                return static_cast<Implementation>(impl);
+            }
+        }
+        std::cerr << "[WARN] ARGON2_CPU_IMPL=" << requested
+                  << " is not supported, using " << IMPL_NAMES[best]
+                  << std::endl;
+    }
+    return best;
+}
+
+Implementation getImplementation()
+{
+    static const Implementation impl = detectImplementation();
+    return impl;
+}
+
+const char *getImplementationName(Implementation impl)
+{
+    return IMPL_NAMES[impl];
+}
+
+static void nextAddresses(FillBlockFunction fillBlock,
+                          Block &address, Block &input, const Block &zero)
+{
+    input.v[6]++;
+    fillBlock(zero, input, address, false);
+    fillBlock(zero, address, address, false);
+}
+
+static std::uint32_t indexAlpha(std::uint32_t pass, std::uint32_t slice,
+                                std::uint32_t index, std::uint32_t pseudoRand,
+                                bool sameLane, std::uint32_t segmentBlocks)
+{
+    std::uint32_t laneBlocks = segmentBlocks * ARGON2_SYNC_POINTS;
+
+    std::uint32_t areaSize;
+    if (pass == 0) {
+        if (slice == 0) {
+            areaSize = index - 1;
+        } else if (sameLane) {
+            areaSize = slice * segmentBlocks + index - 1;
+        } else {
+            areaSize = slice * segmentBlocks + (index == 0 ? -1 : 0);
+        }
+    } else {
+        if (sameLane) {
+            areaSize = laneBlocks - segmentBlocks + index - 1;
+        } else {
+            areaSize = laneBlocks - segmentBlocks + (index == 0 ? -1 : 0);
+        }
+    }
+
+    std::uint64_t relPos = pseudoRand;
+    relPos = relPos * relPos >> 32;
+    relPos = areaSize - 1 - (areaSize * relPos >> 32);
+
+    std::uint32_t startPos = 0;
+    if (pass != 0 && slice != ARGON2_SYNC_POINTS - 1) {
+        startPos = (slice + 1) * segmentBlocks;
+    }
+    return static_cast<std::uint32_t>((startPos + relPos) % laneBlocks);
+}
+
+static inline const Block &refBlock(
+        const Block *memory, std::uint64_t pseudoRand,
+        std::uint32_t lanes, std::uint32_t segmentBlocks, std::uint32_t pass,
+        std::uint32_t slice, std::uint32_t lane, std::uint32_t index)
+{
+    std::uint32_t refLane = static_cast<std::uint32_t>(
+                (pseudoRand >> 32) % lanes);
+    if (pass == 0 && slice == 0) {
+        refLane = lane;
+    }
+    std::uint32_t refIndex = indexAlpha(
+                pass, slice, index, static_cast<std::uint32_t>(pseudoRand),
+                refLane == lane, segmentBlocks);
+    return memory[refIndex * lanes + refLane];
+}
+
+static inline void prefetchBlock(const Block &block)
+{
+#ifdef __GNUC__
+    auto bytes = reinterpret_cast<const char *>(block.v);
+    for (std::size_t i = 0; i < ARGON2_BLOCK_SIZE; i += 64) {
+        __builtin_prefetch(bytes + i);
+    }
+#else
+    (void)block;
+#endif
+}
+
+/* Fills the same segment of every job of the group, one block of each job
+ * at a time. The reference block of each job is a random (and with
+ * data-dependent addressing also unpredictable) load, so interleaving the
+ * jobs lets the loads of one overlap with the computation of the others: */
+static void fillSegment(FillBlockFunction fillBlock,
+                        Block *const *memories, std::size_t count,
+                        Type type, Version version,
+                        std::uint32_t passes, std::uint32_t lanes,
+                        std::uint32_t segmentBlocks, std::uint32_t pass,
+                        std::uint32_t slice, std::uint32_t lane)
+{
+    std::uint32_t laneBlocks = segmentBlocks * ARGON2_SYNC_POINTS;
+
+    bool dataIndependent = type == ARGON2_I
+            || (type == ARGON2_ID && pass == 0
+                && slice < ARGON2_SYNC_POINTS / 2);
+
+    /* the addresses only depend on the parameters, so all jobs share them: */
+    Block address, input, zero = {};
+    if (dataIndependent) {
+        input = zero;
+        input.v[0] = pass;
+        input.v[1] = lane;
+        input.v[2] = slice;
+        input.v[3] = laneBlocks * lanes;
+        input.v[4] = passes;
+        input.v[5] = type;
+    }
+
+    std::uint32_t startIndex = 0;
+    if (pass == 0 && slice == 0) {
+        /* the first two blocks are already there: */
+        startIndex = 2;
+        if (dataIndependent) {
+            nextAddresses(fillBlock, address, input, zero);
+        }
+    }
+
+    bool withXor = version != ARGON2_VERSION_10 && pass != 0;
+    for (std::uint32_t i = startIndex; i < segmentBlocks; i++) {
+        std::uint32_t curr = slice * segmentBlocks + i;
+        std::uint32_t prev = curr == 0 ? laneBlocks - 1 : curr - 1;
+
+        if (dataIndependent && i % ARGON2_ADDRESSES_IN_BLOCK == 0) {
+            nextAddresses(fillBlock, address, input, zero);
+        }
+
+        for (std::size_t j = 0; j < count; j++) {
+            Block *memory = memories[j];
+
+            std::uint64_t pseudoRand = dataIndependent
+                    ? address.v[i % ARGON2_ADDRESSES_IN_BLOCK]
+                    : memory[prev * lanes + lane].v[0];
+
+            Block &next = memory[curr * lanes + lane];
+            fillBlock(memory[prev * lanes + lane],
+                      refBlock(memory, pseudoRand, lanes, segmentBlocks,
+                               pass, slice, lane, i),
+                      next, withXor);
+
+            /* start loading the next reference block of this job while the
+             * other jobs compute theirs (a lone job would wait for it right
+             * away, so that only costs time): */
+            if (count > 1 && i + 1 < segmentBlocks) {
+                if (!dataIndependent) {
+                    pseudoRand = next.v[0];
+                } else if ((i + 1) % ARGON2_ADDRESSES_IN_BLOCK != 0) {
+                    pseudoRand = address.v[(i + 1) % ARGON2_ADDRESSES_IN_BLOCK];
+                } else {
+                    continue;
+                }
+                prefetchBlock(refBlock(memory, pseudoRand, lanes,
+                                       segmentBlocks, pass, slice, lane,
+                                       i + 1));
+            }
+        }
+    }
+}
+
+void fillMemory(Block *const *memories, std::size_t count,
+                Type type, Version version,
+                std::uint32_t passes, std::uint32_t lanes,
+                std::uint32_t segmentBlocks, Implementation impl)
+{
+    FillBlockFunction fillBlock = getFillBlock(impl);
+
+    for (std::uint32_t pass = 0; pass < passes; pass++) {
+        for (std::uint32_t slice = 0; slice < ARGON2_SYNC_POINTS; slice++) {
+            /* lanes only depend on each other across slices: */
+            for (std::uint32_t lane = 0; lane < lanes; lane++) {
+                fillSegment(fillBlock, memories, count, type, version,
+                            passes, lanes, segmentBlocks, pass, slice, lane);
+            }
+        }
+    }
+}
+
+} // namespace cpu
+} // namespace argon2
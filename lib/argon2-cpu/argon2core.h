@@ -0,0 +1,50 @@
+#ifndef ARGON2_CPU_ARGON2CORE_H
+#define ARGON2_CPU_ARGON2CORE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "argon2-gpu-common/argon2-common.h"
+
+namespace argon2 {
+namespace cpu {
+
+enum {
+    ARGON2_QWORDS_IN_BLOCK = ARGON2_BLOCK_SIZE / 8,
+    ARGON2_ADDRESSES_IN_BLOCK = 128,
+};
+
+struct Block
+{
+    std::uint64_t v[ARGON2_QWORDS_IN_BLOCK];
+};
+
+/* Instruction sets the block compression is implemented for, from the
+ * slowest to the fastest: */
+enum Implementation {
+    IMPL_PORTABLE,
+    IMPL_SSE41,
+    IMPL_AVX2,
+    IMPL_AVX512F,
+};
+
+/* Returns the fastest implementation supported by the CPU (detected once,
+ * via CPUID). It can be lowered (e.g. for testing or benchmarking) by setting
+ * ARGON2_CPU_IMPL to "portable", "sse4.1", "avx2" or "avx512f": */
+Implementation getImplementation();
+const char *getImplementationName(Implementation impl);
+
+/* Runs all passes of Argon2 over the memory of each of count jobs with the
+ * same parameters, in lockstep (one block of each job in turn). The memory
+ * of a job uses the same layout as the GPU backends (block-major: all lanes
+ * of block 0, then all lanes of block 1, ...), and the first two blocks of
+ * every lane must already be filled in (see Argon2Params::fillFirstBlocks()): */
+void fillMemory(Block *const *memories, std::size_t count,
+                Type type, Version version,
+                std::uint32_t passes, std::uint32_t lanes,
+                std::uint32_t segmentBlocks, Implementation impl);
+
+} // namespace cpu
+} // namespace argon2
+
+#endif // ARGON2_CPU_ARGON2CORE_H
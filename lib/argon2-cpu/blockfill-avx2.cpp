@@ -0,0 +1,157 @@
+#include "blockfill.h"
+
+#ifdef __AVX2__
+
+#include <immintrin.h>
+
+namespace argon2 {
+namespace cpu {
+
+/* The block is held in 32 256-bit registers; a Blake2b round works on
+ * 8 of them, i.e. on two rows (or columns) of the block at once. */
+
+#define ROTR32(x) _mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define ROTR24(x) _mm256_shuffle_epi8((x), _mm256_setr_epi8( \
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, \
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10))
+#define ROTR16(x) _mm256_shuffle_epi8((x), _mm256_setr_epi8( \
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, \
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9))
+#define ROTR63(x) _mm256_xor_si256(_mm256_srli_epi64((x), 63), \
+                                   _mm256_add_epi64((x), (x)))
+
+static inline __m256i fBlaMka(__m256i x, __m256i y)
+{
+    __m256i z = _mm256_mul_epu32(x, y);
+    return _mm256_add_epi64(_mm256_add_epi64(x, y), _mm256_add_epi64(z, z));
+}
+
+#define G1(A0, A1, B0, B1, C0, C1, D0, D1) \
+    do { \
+        A0 = fBlaMka(A0, B0); A1 = fBlaMka(A1, B1); \
+        D0 = _mm256_xor_si256(D0, A0); D1 = _mm256_xor_si256(D1, A1); \
+        D0 = ROTR32(D0); D1 = ROTR32(D1); \
+        C0 = fBlaMka(C0, D0); C1 = fBlaMka(C1, D1); \
+        B0 = _mm256_xor_si256(B0, C0); B1 = _mm256_xor_si256(B1, C1); \
+        B0 = ROTR24(B0); B1 = ROTR24(B1); \
+    } while (0)
+
+#define G2(A0, A1, B0, B1, C0, C1, D0, D1) \
+    do { \
+        A0 = fBlaMka(A0, B0); A1 = fBlaMka(A1, B1); \
+        D0 = _mm256_xor_si256(D0, A0); D1 = _mm256_xor_si256(D1, A1); \
+        D0 = ROTR16(D0); D1 = ROTR16(D1); \
+        C0 = fBlaMka(C0, D0); C1 = fBlaMka(C1, D1); \
+        B0 = _mm256_xor_si256(B0, C0); B1 = _mm256_xor_si256(B1, C1); \
+        B0 = ROTR63(B0); B1 = ROTR63(B1); \
+    } while (0)
+
+/* rows: each register holds 4 consecutive words of one row */
+#define DIAGONALIZE_1(A0, B0, C0, D0, A1, B1, C1, D1) \
+    do { \
+        B0 = _mm256_permute4x64_epi64(B0, _MM_SHUFFLE(0, 3, 2, 1)); \
+        C0 = _mm256_permute4x64_epi64(C0, _MM_SHUFFLE(1, 0, 3, 2)); \
+        D0 = _mm256_permute4x64_epi64(D0, _MM_SHUFFLE(2, 1, 0, 3)); \
+        B1 = _mm256_permute4x64_epi64(B1, _MM_SHUFFLE(0, 3, 2, 1)); \
+        C1 = _mm256_permute4x64_epi64(C1, _MM_SHUFFLE(1, 0, 3, 2)); \
+        D1 = _mm256_permute4x64_epi64(D1, _MM_SHUFFLE(2, 1, 0, 3)); \
+    } while (0)
+
+#define UNDIAGONALIZE_1(A0, B0, C0, D0, A1, B1, C1, D1) \
+    do { \
+        B0 = _mm256_permute4x64_epi64(B0, _MM_SHUFFLE(2, 1, 0, 3)); \
+        C0 = _mm256_permute4x64_epi64(C0, _MM_SHUFFLE(1, 0, 3, 2)); \
+        D0 = _mm256_permute4x64_epi64(D0, _MM_SHUFFLE(0, 3, 2, 1)); \
+        B1 = _mm256_permute4x64_epi64(B1, _MM_SHUFFLE(2, 1, 0, 3)); \
+        C1 = _mm256_permute4x64_epi64(C1, _MM_SHUFFLE(1, 0, 3, 2)); \
+        D1 = _mm256_permute4x64_epi64(D1, _MM_SHUFFLE(0, 3, 2, 1)); \
+    } while (0)
+
+/* columns: each register holds two word pairs of two different rows */
+#define DIAGONALIZE_2(A0, A1, B0, B1, C0, C1, D0, D1) \
+    do { \
+        __m256i t0 = _mm256_blend_epi32(B0, B1, 0xCC); \
+        __m256i t1 = _mm256_blend_epi32(B0, B1, 0x33); \
+        B1 = _mm256_permute4x64_epi64(t0, _MM_SHUFFLE(2, 3, 0, 1)); \
+        B0 = _mm256_permute4x64_epi64(t1, _MM_SHUFFLE(2, 3, 0, 1)); \
+        t0 = C0; C0 = C1; C1 = t0; \
+        t0 = _mm256_blend_epi32(D0, D1, 0xCC); \
+        t1 = _mm256_blend_epi32(D0, D1, 0x33); \
+        D0 = _mm256_permute4x64_epi64(t0, _MM_SHUFFLE(2, 3, 0, 1)); \
+        D1 = _mm256_permute4x64_epi64(t1, _MM_SHUFFLE(2, 3, 0, 1)); \
+    } while (0)
+
+#define UNDIAGONALIZE_2(A0, A1, B0, B1, C0, C1, D0, D1) \
+    do { \
+        __m256i t0 = _mm256_blend_epi32(B0, B1, 0xCC); \
+        __m256i t1 = _mm256_blend_epi32(B0, B1, 0x33); \
+        B0 = _mm256_permute4x64_epi64(t0, _MM_SHUFFLE(2, 3, 0, 1)); \
+        B1 = _mm256_permute4x64_epi64(t1, _MM_SHUFFLE(2, 3, 0, 1)); \
+        t0 = C0; C0 = C1; C1 = t0; \
+        t0 = _mm256_blend_epi32(D0, D1, 0x33); \
+        t1 = _mm256_blend_epi32(D0, D1, 0xCC); \
+        D0 = _mm256_permute4x64_epi64(t0, _MM_SHUFFLE(2, 3, 0, 1)); \
+        D1 = _mm256_permute4x64_epi64(t1, _MM_SHUFFLE(2, 3, 0, 1)); \
+    } while (0)
+
+#define BLAKE2_ROUND_1(A0, A1, B0, B1, C0, C1, D0, D1) \
+    do { \
+        G1(A0, A1, B0, B1, C0, C1, D0, D1); \
+        G2(A0, A1, B0, B1, C0, C1, D0, D1); \
+        DIAGONALIZE_1(A0, B0, C0, D0, A1, B1, C1, D1); \
+        G1(A0, A1, B0, B1, C0, C1, D0, D1); \
+        G2(A0, A1, B0, B1, C0, C1, D0, D1); \
+        UNDIAGONALIZE_1(A0, B0, C0, D0, A1, B1, C1, D1); \
+    } while (0)
+
+#define BLAKE2_ROUND_2(A0, A1, B0, B1, C0, C1, D0, D1) \
+    do { \
+        G1(A0, A1, B0, B1, C0, C1, D0, D1); \
+        G2(A0, A1, B0, B1, C0, C1, D0, D1); \
+        DIAGONALIZE_2(A0, A1, B0, B1, C0, C1, D0, D1); \
+        G1(A0, A1, B0, B1, C0, C1, D0, D1); \
+        G2(A0, A1, B0, B1, C0, C1, D0, D1); \
+        UNDIAGONALIZE_2(A0, A1, B0, B1, C0, C1, D0, D1); \
+    } while (0)
+
+void fillBlockAvx2(const Block &prev, const Block &ref, Block &next,
+                   bool withXor)
+{
+    enum { REGS = ARGON2_BLOCK_SIZE / sizeof(__m256i) };
+
+    auto prevRegs = reinterpret_cast<const __m256i *>(prev.v);
+    auto refRegs = reinterpret_cast<const __m256i *>(ref.v);
+    auto nextRegs = reinterpret_cast<__m256i *>(next.v);
+
+    __m256i state[REGS], tmp[REGS];
+    for (std::size_t i = 0; i < REGS; i++) {
+        state[i] = _mm256_xor_si256(_mm256_loadu_si256(prevRegs + i),
+                                    _mm256_loadu_si256(refRegs + i));
+        tmp[i] = withXor
+                ? _mm256_xor_si256(state[i], _mm256_loadu_si256(nextRegs + i))
+                : state[i];
+    }
+
+    for (std::size_t i = 0; i < 4; i++) {
+        BLAKE2_ROUND_1(state[8 * i + 0], state[8 * i + 4],
+                       state[8 * i + 1], state[8 * i + 5],
+                       state[8 * i + 2], state[8 * i + 6],
+                       state[8 * i + 3], state[8 * i + 7]);
+    }
+
+    for (std::size_t i = 0; i < 4; i++) {
+        BLAKE2_ROUND_2(state[ 0 + i], state[ 4 + i],
+                       state[ 8 + i], state[12 + i],
+                       state[16 + i], state[20 + i],
+                       state[24 + i], state[28 + i]);
+    }
+
+    for (std::size_t i = 0; i < REGS; i++) {
+        _mm256_storeu_si256(nextRegs + i, _mm256_xor_si256(state[i], tmp[i]));
+    }
+}
+
+} // namespace cpu
+} // namespace argon2
+
+#endif /* __AVX2__ */
@@ -0,0 +1,150 @@
+#include "blockfill.h"
+
+#ifdef __AVX512F__
+
+#include <immintrin.h>
+
+namespace argon2 {
+namespace cpu {
+
+/* The block is held in 16 512-bit registers; a Blake2b round works on
+ * 8 of them, i.e. on four rows (or columns) of the block at once. */
+
+static inline __m512i fBlaMka(__m512i x, __m512i y)
+{
+    __m512i z = _mm512_mul_epu32(x, y);
+    return _mm512_add_epi64(_mm512_add_epi64(x, y), _mm512_add_epi64(z, z));
+}
+
+#define G1(A0, B0, C0, D0, A1, B1, C1, D1) \
+    do { \
+        A0 = fBlaMka(A0, B0); A1 = fBlaMka(A1, B1); \
+        D0 = _mm512_xor_si512(D0, A0); D1 = _mm512_xor_si512(D1, A1); \
+        D0 = _mm512_ror_epi64(D0, 32); D1 = _mm512_ror_epi64(D1, 32); \
+        C0 = fBlaMka(C0, D0); C1 = fBlaMka(C1, D1); \
+        B0 = _mm512_xor_si512(B0, C0); B1 = _mm512_xor_si512(B1, C1); \
+        B0 = _mm512_ror_epi64(B0, 24); B1 = _mm512_ror_epi64(B1, 24); \
+    } while (0)
+
+#define G2(A0, B0, C0, D0, A1, B1, C1, D1) \
+    do { \
+        A0 = fBlaMka(A0, B0); A1 = fBlaMka(A1, B1); \
+        D0 = _mm512_xor_si512(D0, A0); D1 = _mm512_xor_si512(D1, A1); \
+        D0 = _mm512_ror_epi64(D0, 16); D1 = _mm512_ror_epi64(D1, 16); \
+        C0 = fBlaMka(C0, D0); C1 = fBlaMka(C1, D1); \
+        B0 = _mm512_xor_si512(B0, C0); B1 = _mm512_xor_si512(B1, C1); \
+        B0 = _mm512_ror_epi64(B0, 63); B1 = _mm512_ror_epi64(B1, 63); \
+    } while (0)
+
+#define DIAGONALIZE(A0, B0, C0, D0, A1, B1, C1, D1) \
+    do { \
+        B0 = _mm512_permutex_epi64(B0, _MM_SHUFFLE(0, 3, 2, 1)); \
+        B1 = _mm512_permutex_epi64(B1, _MM_SHUFFLE(0, 3, 2, 1)); \
+        C0 = _mm512_permutex_epi64(C0, _MM_SHUFFLE(1, 0, 3, 2)); \
+        C1 = _mm512_permutex_epi64(C1, _MM_SHUFFLE(1, 0, 3, 2)); \
+        D0 = _mm512_permutex_epi64(D0, _MM_SHUFFLE(2, 1, 0, 3)); \
+        D1 = _mm512_permutex_epi64(D1, _MM_SHUFFLE(2, 1, 0, 3)); \
+    } while (0)
+
+#define UNDIAGONALIZE(A0, B0, C0, D0, A1, B1, C1, D1) \
+    do { \
+        B0 = _mm512_permutex_epi64(B0, _MM_SHUFFLE(2, 1, 0, 3)); \
+        B1 = _mm512_permutex_epi64(B1, _MM_SHUFFLE(2, 1, 0, 3)); \
+        C0 = _mm512_permutex_epi64(C0, _MM_SHUFFLE(1, 0, 3, 2)); \
+        C1 = _mm512_permutex_epi64(C1, _MM_SHUFFLE(1, 0, 3, 2)); \
+        D0 = _mm512_permutex_epi64(D0, _MM_SHUFFLE(0, 3, 2, 1)); \
+        D1 = _mm512_permutex_epi64(D1, _MM_SHUFFLE(0, 3, 2, 1)); \
+    } while (0)
+
+#define BLAKE2_ROUND(A0, B0, C0, D0, A1, B1, C1, D1) \
+    do { \
+        G1(A0, B0, C0, D0, A1, B1, C1, D1); \
+        G2(A0, B0, C0, D0, A1, B1, C1, D1); \
+        DIAGONALIZE(A0, B0, C0, D0, A1, B1, C1, D1); \
+        G1(A0, B0, C0, D0, A1, B1, C1, D1); \
+        G2(A0, B0, C0, D0, A1, B1, C1, D1); \
+        UNDIAGONALIZE(A0, B0, C0, D0, A1, B1, C1, D1); \
+    } while (0)
+
+#define SWAP_HALVES(A0, A1) \
+    do { \
+        __m512i t0 = _mm512_shuffle_i64x2(A0, A1, _MM_SHUFFLE(1, 0, 1, 0)); \
+        __m512i t1 = _mm512_shuffle_i64x2(A0, A1, _MM_SHUFFLE(3, 2, 3, 2)); \
+        A0 = t0; A1 = t1; \
+    } while (0)
+
+#define SWAP_QUARTERS(A0, A1) \
+    do { \
+        SWAP_HALVES(A0, A1); \
+        A0 = _mm512_permutexvar_epi64(_mm512_setr_epi64(0, 1, 4, 5, 2, 3, 6, 7), A0); \
+        A1 = _mm512_permutexvar_epi64(_mm512_setr_epi64(0, 1, 4, 5, 2, 3, 6, 7), A1); \
+    } while (0)
+
+#define UNSWAP_QUARTERS(A0, A1) \
+    do { \
+        A0 = _mm512_permutexvar_epi64(_mm512_setr_epi64(0, 1, 4, 5, 2, 3, 6, 7), A0); \
+        A1 = _mm512_permutexvar_epi64(_mm512_setr_epi64(0, 1, 4, 5, 2, 3, 6, 7), A1); \
+        SWAP_HALVES(A0, A1); \
+    } while (0)
+
+/* rows: */
+#define BLAKE2_ROUND_1(A0, C0, B0, D0, A1, C1, B1, D1) \
+    do { \
+        SWAP_HALVES(A0, B0); SWAP_HALVES(C0, D0); \
+        SWAP_HALVES(A1, B1); SWAP_HALVES(C1, D1); \
+        BLAKE2_ROUND(A0, B0, C0, D0, A1, B1, C1, D1); \
+        SWAP_HALVES(A0, B0); SWAP_HALVES(C0, D0); \
+        SWAP_HALVES(A1, B1); SWAP_HALVES(C1, D1); \
+    } while (0)
+
+/* columns: */
+#define BLAKE2_ROUND_2(A0, A1, B0, B1, C0, C1, D0, D1) \
+    do { \
+        SWAP_QUARTERS(A0, A1); SWAP_QUARTERS(B0, B1); \
+        SWAP_QUARTERS(C0, C1); SWAP_QUARTERS(D0, D1); \
+        BLAKE2_ROUND(A0, B0, C0, D0, A1, B1, C1, D1); \
+        UNSWAP_QUARTERS(A0, A1); UNSWAP_QUARTERS(B0, B1); \
+        UNSWAP_QUARTERS(C0, C1); UNSWAP_QUARTERS(D0, D1); \
+    } while (0)
+
+void fillBlockAvx512f(const Block &prev, const Block &ref, Block &next,
+                      bool withXor)
+{
+    enum { REGS = ARGON2_BLOCK_SIZE / sizeof(__m512i) };
+
+    auto prevRegs = reinterpret_cast<const __m512i *>(prev.v);
+    auto refRegs = reinterpret_cast<const __m512i *>(ref.v);
+    auto nextRegs = reinterpret_cast<__m512i *>(next.v);
+
+    __m512i state[REGS], tmp[REGS];
+    for (std::size_t i = 0; i < REGS; i++) {
+        state[i] = _mm512_xor_si512(_mm512_loadu_si512(prevRegs + i),
+                                    _mm512_loadu_si512(refRegs + i));
+        tmp[i] = withXor
+                ? _mm512_xor_si512(state[i], _mm512_loadu_si512(nextRegs + i))
+                : state[i];
+    }
+
+    for (std::size_t i = 0; i < 2; i++) {
+        BLAKE2_ROUND_1(state[8 * i + 0], state[8 * i + 1],
+                       state[8 * i + 2], state[8 * i + 3],
+                       state[8 * i + 4], state[8 * i + 5],
+                       state[8 * i + 6], state[8 * i + 7]);
+    }
+
+    for (std::size_t i = 0; i < 2; i++) {
+        BLAKE2_ROUND_2(state[2 * 0 + i], state[2 * 1 + i],
+                       state[2 * 2 + i], state[2 * 3 + i],
+                       state[2 * 4 + i], state[2 * 5 + i],
+                       state[2 * 6 + i], state[2 * 7 + i]);
+    }
+
+    for (std::size_t i = 0; i < REGS; i++) {
+        _mm512_storeu_si512(nextRegs + i, _mm512_xor_si512(state[i], tmp[i]));
+    }
+}
+
+} // namespace cpu
+} // namespace argon2
+
+#endif /* __AVX512F__ */
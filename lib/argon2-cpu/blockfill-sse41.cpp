@@ -0,0 +1,118 @@
+#include "blockfill.h"
+
+#ifdef __SSE4_1__
+
+#include <smmintrin.h>
+
+namespace argon2 {
+namespace cpu {
+
+/* The block is held in 64 128-bit registers; a Blake2b round works on
+ * 8 of them (two 64-bit words each). */
+
+#define ROTR32(x) _mm_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define ROTR24(x) _mm_shuffle_epi8((x), _mm_setr_epi8( \
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10))
+#define ROTR16(x) _mm_shuffle_epi8((x), _mm_setr_epi8( \
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9))
+#define ROTR63(x) _mm_xor_si128(_mm_srli_epi64((x), 63), _mm_add_epi64((x), (x)))
+
+static inline __m128i fBlaMka(__m128i x, __m128i y)
+{
+    __m128i z = _mm_mul_epu32(x, y);
+    return _mm_add_epi64(_mm_add_epi64(x, y), _mm_add_epi64(z, z));
+}
+
+#define G1(A0, B0, C0, D0, A1, B1, C1, D1) \
+    do { \
+        A0 = fBlaMka(A0, B0); A1 = fBlaMka(A1, B1); \
+        D0 = _mm_xor_si128(D0, A0); D1 = _mm_xor_si128(D1, A1); \
+        D0 = ROTR32(D0); D1 = ROTR32(D1); \
+        C0 = fBlaMka(C0, D0); C1 = fBlaMka(C1, D1); \
+        B0 = _mm_xor_si128(B0, C0); B1 = _mm_xor_si128(B1, C1); \
+        B0 = ROTR24(B0); B1 = ROTR24(B1); \
+    } while (0)
+
+#define G2(A0, B0, C0, D0, A1, B1, C1, D1) \
+    do { \
+        A0 = fBlaMka(A0, B0); A1 = fBlaMka(A1, B1); \
+        D0 = _mm_xor_si128(D0, A0); D1 = _mm_xor_si128(D1, A1); \
+        D0 = ROTR16(D0); D1 = ROTR16(D1); \
+        C0 = fBlaMka(C0, D0); C1 = fBlaMka(C1, D1); \
+        B0 = _mm_xor_si128(B0, C0); B1 = _mm_xor_si128(B1, C1); \
+        B0 = ROTR63(B0); B1 = ROTR63(B1); \
+    } while (0)
+
+#define DIAGONALIZE(A0, B0, C0, D0, A1, B1, C1, D1) \
+    do { \
+        __m128i t0 = _mm_alignr_epi8(B1, B0, 8); \
+        __m128i t1 = _mm_alignr_epi8(B0, B1, 8); \
+        B0 = t0; B1 = t1; \
+        t0 = C0; C0 = C1; C1 = t0; \
+        t0 = _mm_alignr_epi8(D1, D0, 8); \
+        t1 = _mm_alignr_epi8(D0, D1, 8); \
+        D0 = t1; D1 = t0; \
+    } while (0)
+
+#define UNDIAGONALIZE(A0, B0, C0, D0, A1, B1, C1, D1) \
+    do { \
+        __m128i t0 = _mm_alignr_epi8(B0, B1, 8); \
+        __m128i t1 = _mm_alignr_epi8(B1, B0, 8); \
+        B0 = t0; B1 = t1; \
+        t0 = C0; C0 = C1; C1 = t0; \
+        t0 = _mm_alignr_epi8(D0, D1, 8); \
+        t1 = _mm_alignr_epi8(D1, D0, 8); \
+        D0 = t1; D1 = t0; \
+    } while (0)
+
+#define BLAKE2_ROUND(A0, A1, B0, B1, C0, C1, D0, D1) \
+    do { \
+        G1(A0, B0, C0, D0, A1, B1, C1, D1); \
+        G2(A0, B0, C0, D0, A1, B1, C1, D1); \
+        DIAGONALIZE(A0, B0, C0, D0, A1, B1, C1, D1); \
+        G1(A0, B0, C0, D0, A1, B1, C1, D1); \
+        G2(A0, B0, C0, D0, A1, B1, C1, D1); \
+        UNDIAGONALIZE(A0, B0, C0, D0, A1, B1, C1, D1); \
+    } while (0)
+
+void fillBlockSse41(const Block &prev, const Block &ref, Block &next,
+                    bool withXor)
+{
+    enum { REGS = ARGON2_BLOCK_SIZE / sizeof(__m128i) };
+
+    auto prevRegs = reinterpret_cast<const __m128i *>(prev.v);
+    auto refRegs = reinterpret_cast<const __m128i *>(ref.v);
+    auto nextRegs = reinterpret_cast<__m128i *>(next.v);
+
+    __m128i state[REGS], tmp[REGS];
+    for (std::size_t i = 0; i < REGS; i++) {
+        state[i] = _mm_xor_si128(_mm_loadu_si128(prevRegs + i),
+                                 _mm_loadu_si128(refRegs + i));
+        tmp[i] = withXor
+                ? _mm_xor_si128(state[i], _mm_loadu_si128(nextRegs + i))
+                : state[i];
+    }
+
+    for (std::size_t i = 0; i < 8; i++) {
+        BLAKE2_ROUND(state[8 * i + 0], state[8 * i + 1],
+                     state[8 * i + 2], state[8 * i + 3],
+                     state[8 * i + 4], state[8 * i + 5],
+                     state[8 * i + 6], state[8 * i + 7]);
+    }
+
+    for (std::size_t i = 0; i < 8; i++) {
+        BLAKE2_ROUND(state[8 * 0 + i], state[8 * 1 + i],
+                     state[8 * 2 + i], state[8 * 3 + i],
+                     state[8 * 4 + i], state[8 * 5 + i],
+                     state[8 * 6 + i], state[8 * 7 + i]);
+    }
+
+    for (std::size_t i = 0; i < REGS; i++) {
+        _mm_storeu_si128(nextRegs + i, _mm_xor_si128(state[i], tmp[i]));
+    }
+}
+
+} // namespace cpu
+} // namespace argon2
+
+#endif /* __SSE4_1__ */
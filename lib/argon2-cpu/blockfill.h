@@ -0,0 +1,30 @@
+#ifndef ARGON2_CPU_BLOCKFILL_H
+#define ARGON2_CPU_BLOCKFILL_H
+
+#include "argon2core.h"
+
+namespace argon2 {
+namespace cpu {
+
+/* The compression function G of Argon2, one variant per instruction set:
+ *
+ *   next = P(prev ^ ref) ^ prev ^ ref (^ next, if withXor)
+ *
+ * where P applies the Blake2b round to the rows and then to the columns of
+ * the block (viewed as an 8x8 matrix of 16-byte registers), just like
+ * argon2_core()/shuffle_block() in argon2_kernel.cl. The SIMD variants are
+ * only compiled on x86 and must only be called when the CPU supports them
+ * (see getImplementation()): */
+void fillBlockPortable(const Block &prev, const Block &ref, Block &next,
+                       bool withXor);
+void fillBlockSse41(const Block &prev, const Block &ref, Block &next,
+                    bool withXor);
+void fillBlockAvx2(const Block &prev, const Block &ref, Block &next,
+                   bool withXor);
+void fillBlockAvx512f(const Block &prev, const Block &ref, Block &next,
+                      bool withXor);
+
+} // namespace cpu
+} // namespace argon2
+
+#endif // ARGON2_CPU_BLOCKFILL_H
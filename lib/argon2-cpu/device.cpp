@@ -0,0 +1,45 @@
+#include "device.h"
+
+#include "argon2core.h"
+
+#include <string>
+
+#ifdef __unix__
+#include <unistd.h>
+#endif
+
+namespace argon2 {
+namespace cpu {
+
+std::string Device::getName() const
+{
+    return "CPU (" + std::to_string(threadCount) + " threads)";
+}
+
+std::string Device::getInfo() const
+{
+    return "CPU Device: " + std::to_string(threadCount) + " threads, "
+            + std::to_string(getGlobalMemorySize()) + " bytes of memory, "
+            + getImplementationName(getImplementation()) + " block compression";
+}
+
+std::uint64_t Device::getGlobalMemorySize() const
+{
+#if defined(__unix__) && defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && pageSize > 0) {
+        return static_cast<std::uint64_t>(pages)
+                * static_cast<std::uint64_t>(pageSize);
+    }
+#endif
+    return 0;
+}
+
+std::uint64_t Device::getMaxAllocationSize() const
+{
+    return getGlobalMemorySize();
+}
+
+} // namespace cpu
+} // namespace argon2
@@ -0,0 +1,17 @@
+#include "globalcontext.h"
+
+#include <thread>
+
+namespace argon2 {
+namespace cpu {
+
+GlobalContext::GlobalContext()
+    : devices()
+{
+    /* hardware_concurrency() may return 0 when it cannot tell: */
+    std::size_t threads = std::thread::hardware_concurrency();
+    devices.emplace_back(threads != 0 ? threads : 1);
+}
+
+} // namespace cpu
+} // namespace argon2
@@ -0,0 +1,272 @@
+#include "kernelrunner.h"
+
+#include "argon2core.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#ifndef NDEBUG
+#include <iostream>
+#endif
+
+namespace argon2 {
+namespace cpu {
+
+/* Beyond this, the extra memory latency a group can hide does not pay for
+ * its cache footprint: */
+enum {
+    MAX_JOBS_PER_GROUP = 8,
+};
+
+/* The host memory a runner may take (with some of it left to the rest of
+ * the system), or the maximum if it is unknown: */
+static std::uint64_t getUsableMemory(const Device *device)
+{
+    std::uint64_t hostMemory = device->getGlobalMemorySize();
+    if (hostMemory == 0) {
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+    return hostMemory - hostMemory / 10;
+}
+
+/* The host and worker copies of the first and last blocks of a job: */
+static std::uint64_t getJobMemory(const Argon2Params *params)
+{
+    return 2 * 3 * std::uint64_t(params->getLanes()) * ARGON2_BLOCK_SIZE;
+}
+
+std::size_t KernelRunner::getMaxBatchSize(const Argon2Params *params,
+                                          const Device *device)
+{
+    std::uint64_t usable = getUsableMemory(device);
+    if (usable == std::numeric_limits<std::uint64_t>::max()) {
+        /* unknown, so just trust the caller: */
+        return std::numeric_limits<std::size_t>::max();
+    }
+
+    /* only the smallest arenas (one job per worker) are charged, with as
+     * many workers as fit; the constructor shrinks the groups (and if need
+     * be the pool) to what is left: */
+    std::uint64_t memorySize = params->getMemorySize();
+    std::uint64_t workerCount = std::min<std::uint64_t>(
+                std::max<std::size_t>(1, device->getThreadCount()),
+                usable / memorySize);
+    std::uint64_t arenasSize = workerCount * memorySize;
+    if (workerCount == 0 || usable <= arenasSize) {
+        return 0;
+    }
+
+    return static_cast<std::size_t>(std::min<std::uint64_t>(
+            (usable - arenasSize) / getJobMemory(params),
+            std::numeric_limits<std::size_t>::max()));
+}
+
+KernelRunner::KernelRunner(const ProgramContext *programContext,
+                           const Argon2Params *params, const Device *device,
+                           std::size_t batchSize)
+    : programContext(programContext), params(params), batchSize(batchSize),
+      maxJobsPerGroup(1), jobsPerGroup(1),
+      implementation(getImplementation()),
+      blocksIn(new std::uint8_t[batchSize * getInputSize()]),
+      jobsIn(new std::uint8_t[batchSize * getInputSize()]),
+      blocksOut(new std::uint8_t[batchSize * getOutputSize()]),
+      jobsOut(new std::uint8_t[batchSize * getOutputSize()]),
+      arenas(), workers(), mutex(), startCond(), doneCond(),
+      generation(0), nextJob(0), pendingJobs(0), running(false),
+      stopping(false),
+      error(), start()
+{
+    /* the arenas get the memory that the per-job blocks leave: */
+    std::uint64_t usable = getUsableMemory(device);
+    std::uint64_t jobsSize = batchSize * getJobMemory(params);
+    std::uint64_t arenaJobs = usable > jobsSize
+            ? (usable - jobsSize) / params->getMemorySize() : 0;
+
+    std::size_t workerCount = std::max<std::size_t>(
+                1, std::min<std::uint64_t>(
+                    std::min(device->getThreadCount(), batchSize),
+                    arenaJobs));
+
+    /* don't make the groups so large that some workers would sit idle (or
+     * that the arenas would not fit), so that the tuning only tries group
+     * sizes that fit: */
+    maxJobsPerGroup = std::max<std::size_t>(
+                1, std::min<std::uint64_t>(
+                    std::min<std::size_t>(MAX_JOBS_PER_GROUP,
+                                          batchSize / workerCount),
+                    arenaJobs / workerCount));
+
+#ifndef NDEBUG
+    std::cerr << "[INFO] Using " << getImplementationName(getImplementation())
+              << " block compression." << std::endl;
+    std::cerr << "[INFO] Allocating " << maxJobsPerGroup << " x "
+              << params->getMemorySize() << " bytes for each of "
+              << workerCount << " workers..." << std::endl;
+#endif
+
+    for (std::size_t i = 0; i < workerCount; i++) {
+        arenas.emplace_back(
+                    new std::uint8_t[maxJobsPerGroup * params->getMemorySize()]);
+    }
+
+    workers.reserve(workerCount);
+    try {
+        for (std::size_t i = 0; i < workerCount; i++) {
+            workers.emplace_back(&KernelRunner::runWorker, this, i);
+        }
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        startCond.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        throw;
+    }
+}
+
+KernelRunner::~KernelRunner()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    startCond.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+std::size_t KernelRunner::getInputSize() const
+{
+    return params->getLanes() * 2 * ARGON2_BLOCK_SIZE;
+}
+
+std::size_t KernelRunner::getOutputSize() const
+{
+    return params->getLanes() * ARGON2_BLOCK_SIZE;
+}
+
+void KernelRunner::runGroup(std::uint8_t *arena, std::size_t firstJob,
+                            std::size_t count)
+{
+    std::uint32_t lanes = params->getLanes();
+    std::uint32_t laneBlocks = params->getLaneBlocks();
+
+    Block *memories[MAX_JOBS_PER_GROUP];
+    for (std::size_t i = 0; i < count; i++) {
+        std::uint8_t *memory = arena + i * params->getMemorySize();
+        std::memcpy(memory, jobsIn.get() + (firstJob + i) * getInputSize(),
+                    getInputSize());
+        memories[i] = reinterpret_cast<Block *>(memory);
+    }
+
+    fillMemory(memories, count,
+               programContext->getArgon2Type(),
+               programContext->getArgon2Version(),
+               params->getTimeCost(), lanes, params->getSegmentBlocks(),
+               static_cast<Implementation>(implementation));
+
+    for (std::size_t i = 0; i < count; i++) {
+        std::memcpy(jobsOut.get() + (firstJob + i) * getOutputSize(),
+                    reinterpret_cast<std::uint8_t *>(memories[i])
+                    + static_cast<std::size_t>(laneBlocks - 1) * lanes
+                    * ARGON2_BLOCK_SIZE,
+                    getOutputSize());
+    }
+}
+
+void KernelRunner::runWorker(std::size_t workerIndex)
+{
+    std::uint8_t *arena = arenas[workerIndex].get();
+
+    /* starts at 0 (not the current generation), as run() may have been
+     * called before this thread got here: */
+    std::size_t seenGeneration = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        startCond.wait(lock, [&] {
+            return stopping || generation != seenGeneration;
+        });
+        if (stopping) {
+            return;
+        }
+        seenGeneration = generation;
+
+        while (nextJob < batchSize) {
+            std::size_t firstJob = nextJob;
+            std::size_t count = std::min(jobsPerGroup, batchSize - firstJob);
+            nextJob += count;
+
+            lock.unlock();
+            std::exception_ptr jobError;
+            try {
+                runGroup(arena, firstJob, count);
+            } catch (...) {
+                jobError = std::current_exception();
+            }
+            lock.lock();
+
+            if (jobError && !error) {
+                error = jobError;
+            }
+            pendingJobs -= count;
+            if (pendingJobs == 0) {
+                doneCond.notify_all();
+            }
+        }
+    }
+}
+
+void KernelRunner::run(std::size_t jobsPerGroup)
+{
+    if (jobsPerGroup < 1 || jobsPerGroup > maxJobsPerGroup) {
+        throw std::logic_error("Invalid jobsPerGroup!");
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running) {
+            throw std::logic_error("A batch is already being processed!");
+        }
+        this->jobsPerGroup = jobsPerGroup;
+        std::memcpy(jobsIn.get(), blocksIn.get(), batchSize * getInputSize());
+
+        nextJob = 0;
+        pendingJobs = batchSize;
+        running = true;
+        error = nullptr;
+        generation++;
+        start = std::chrono::steady_clock::now();
+    }
+    startCond.notify_all();
+}
+
+float KernelRunner::finish()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!running) {
+        throw std::logic_error("No batch is being processed!");
+    }
+    doneCond.wait(lock, [&] { return pendingJobs == 0; });
+
+    running = false;
+    std::swap(blocksOut, jobsOut);
+
+    if (error) {
+        std::exception_ptr jobError = error;
+        error = nullptr;
+        std::rethrow_exception(jobError);
+    }
+
+    std::chrono::duration<float, std::milli> time =
+            std::chrono::steady_clock::now() - start;
+    return time.count();
+}
+
+} // namespace cpu
+} // namespace argon2
@@ -0,0 +1,180 @@
+#include "processingunit.h"
+
+#include "argon2-gpu-common/hostbatch.h"
+#include "argon2-gpu-common/tuningcache.h"
+
+#include "argon2core.h"
+
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef NDEBUG
+#include <iostream>
+#endif
+
+namespace argon2 {
+namespace cpu {
+
+static void checkJobParams(const Argon2Params &unitParams,
+                           const Argon2Params &jobParams)
+{
+    if (jobParams.getTimeCost() != unitParams.getTimeCost()
+            || jobParams.getMemoryCost() != unitParams.getMemoryCost()
+            || jobParams.getLanes() != unitParams.getLanes()) {
+        throw std::logic_error("Job params do not match unit params!");
+    }
+}
+
+ProcessingUnit::ProcessingUnit(
+        const ProgramContext *programContext, const Argon2Params *params,
+        const Device *device, std::size_t batchSize, bool, bool)
+    : programContext(programContext), params(params), device(device),
+      runner(programContext, params, device, batchSize),
+      bestJobsPerGroup(runner.getMinJobsPerGroup())
+{
+    /* pre-fill first blocks with pseudo-random data: */
+    std::vector<const void *> pws(batchSize, nullptr);
+    std::vector<std::size_t> pwSizes(batchSize, 0);
+    setPasswords(0, batchSize, pws.data(), pwSizes.data());
+
+    if (runner.getMaxJobsPerGroup() == runner.getMinJobsPerGroup()) {
+        return;
+    }
+
+    /* the group size that fits the caches depends on the implementation: */
+    std::string tuningKey = TuningCache::makeKey(
+                "cpu", device->getName() + ", "
+                + getImplementationName(getImplementation()), *params,
+                programContext->getArgon2Type(),
+                programContext->getArgon2Version(), batchSize, "groups");
+
+    TuningResult tuning;
+    if (TuningCache::instance().lookup(tuningKey, tuning)
+            && tuning.jobsPerBlock >= runner.getMinJobsPerGroup()
+            && tuning.jobsPerBlock <= runner.getMaxJobsPerGroup()) {
+        bestJobsPerGroup = tuning.jobsPerBlock;
+#ifndef NDEBUG
+        std::cerr << "[INFO] Using cached tuning: " << bestJobsPerGroup
+                  << " jobs per group." << std::endl;
+#endif
+        return;
+    }
+
+#ifndef NDEBUG
+    std::cerr << "[INFO] Tuning jobs per group..." << std::endl;
+#endif
+
+    float bestTime = std::numeric_limits<float>::infinity();
+    for (std::size_t jpg = 1; jpg <= runner.getMaxJobsPerGroup();
+         jpg *= 2)
+    {
+        runner.run(jpg);
+        float time = runner.finish();
+
+#ifndef NDEBUG
+        std::cerr << "[INFO]   " << jpg << " jobs per group: "
+                  << time << " ms" << std::endl;
+#endif
+
+        if (time < bestTime) {
+            bestTime = time;
+            bestJobsPerGroup = jpg;
+        }
+    }
+#ifndef NDEBUG
+    std::cerr << "[INFO] Picked " << bestJobsPerGroup
+              << " jobs per group." << std::endl;
+#endif
+
+    TuningCache::instance().store(tuningKey,
+                                  TuningResult { 1, bestJobsPerGroup });
+}
+
+void ProcessingUnit::setPassword(std::size_t index, const void *pw,
+                                 std::size_t pwSize)
+{
+    params->fillFirstBlocks(runner.getInputMemory(index), pw, pwSize,
+                            programContext->getArgon2Type(),
+                            programContext->getArgon2Version());
+}
+
+void ProcessingUnit::getHash(std::size_t index, void *hash)
+{
+    params->finalize(hash, runner.getOutputMemory(index));
+}
+
+void ProcessingUnit::setPassword(std::size_t index,
+                                 const Argon2Params &jobParams,
+                                 const void *pw, std::size_t pwSize)
+{
+    checkJobParams(*params, jobParams);
+
+    jobParams.fillFirstBlocks(runner.getInputMemory(index), pw, pwSize,
+                              programContext->getArgon2Type(),
+                              programContext->getArgon2Version());
+}
+
+void ProcessingUnit::getHash(std::size_t index, const Argon2Params &jobParams,
+                             void *hash)
+{
+    checkJobParams(*params, jobParams);
+
+    jobParams.finalize(hash, runner.getOutputMemory(index));
+}
+
+void ProcessingUnit::setPasswords(std::size_t begin, std::size_t end,
+                                  const void *const *pws,
+                                  const std::size_t *pwSizes,
+                                  const Argon2Params *const *jobParams)
+{
+    if (begin > end || end > runner.getBatchSize()) {
+        throw std::logic_error("Invalid job range!");
+    }
+
+    std::vector<void *> memories(end - begin);
+    for (std::size_t i = 0; i < end - begin; i++) {
+        if (jobParams != nullptr) {
+            checkJobParams(*params, *jobParams[i]);
+        }
+        memories[i] = runner.getInputMemory(begin + i);
+    }
+
+    fillInputs(*params, jobParams, memories.data(), pws, pwSizes,
+               end - begin, programContext->getArgon2Type(),
+               programContext->getArgon2Version(), false);
+}
+
+void ProcessingUnit::getHashes(std::size_t begin, std::size_t end,
+                               void *const *hashes,
+                               const Argon2Params *const *jobParams)
+{
+    if (begin > end || end > runner.getBatchSize()) {
+        throw std::logic_error("Invalid job range!");
+    }
+
+    std::vector<const void *> memories(end - begin);
+    for (std::size_t i = 0; i < end - begin; i++) {
+        if (jobParams != nullptr) {
+            checkJobParams(*params, *jobParams[i]);
+        }
+        memories[i] = runner.getOutputMemory(begin + i);
+    }
+
+    readOutputs(*params, jobParams, hashes, memories.data(), end - begin,
+                false);
+}
+
+void ProcessingUnit::beginProcessing()
+{
+    runner.run(bestJobsPerGroup);
+}
+
+void ProcessingUnit::endProcessing()
+{
+    runner.finish();
+}
+
+} // namespace cpu
+} // namespace argon2
@@ -0,0 +1,15 @@
+#include "programcontext.h"
+
+namespace argon2 {
+namespace cpu {
+
+ProgramContext::ProgramContext(
+        const GlobalContext *globalContext,
+        const std::vector<Device> &,
+        Type type, Version version)
+    : globalContext(globalContext), type(type), version(version)
+{
+}
+
+} // namespace cpu
+} // namespace argon2
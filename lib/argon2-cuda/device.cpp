@@ -38,5 +38,18 @@ std::string Device::getInfo() const
     return "CUDA Device '" + std::string(prop.name) + "'";
 }
 
+std::uint64_t Device::getGlobalMemorySize() const
+{
+    cudaDeviceProp prop;
+    CudaException::check(cudaGetDeviceProperties(&prop, deviceIndex));
+    return prop.totalGlobalMem;
+}
+
+std::uint64_t Device::getMaxAllocationSize() const
+{
+    /* CUDA has no per-allocation limit below the total memory: */
+    return getGlobalMemorySize();
+}
+
 } // namespace cuda
 } // namespace argon2
@@ -6,6 +6,8 @@
 #include "kernelrunner.h"
 #include "cudaexception.h"
 
+#include <algorithm>
+#include <limits>
 #include <stdexcept>
 #ifndef NDEBUG
 #include <iostream>
@@ -797,6 +799,45 @@ __global__ void argon2_kernel_oneshot(
     }
 }
 
+static size_t getRefsSize(uint32_t type, uint32_t passes, uint32_t lanes,
+                          uint32_t segmentBlocks)
+{
+    uint32_t segments =
+            type == ARGON2_ID
+            ? lanes * (ARGON2_SYNC_POINTS / 2)
+            : passes * lanes * ARGON2_SYNC_POINTS;
+
+    return static_cast<size_t>(segments) * segmentBlocks * sizeof(struct ref);
+}
+
+size_t KernelRunner::getMaxBatchSize(uint32_t type, uint32_t passes,
+                                     uint32_t lanes, uint32_t segmentBlocks,
+                                     bool precompute)
+{
+    size_t freeMemory = 0, totalMemory = 0;
+    CudaException::check(cudaMemGetInfo(&freeMemory, &totalMemory));
+
+    /* leave some memory for the driver and other processes: */
+    if (freeMemory <= totalMemory / 20) {
+        return 0;
+    }
+    uint64_t usable = freeMemory - totalMemory / 20;
+
+    if ((type == ARGON2_I || type == ARGON2_ID) && precompute) {
+        uint64_t refsSize = getRefsSize(type, passes, lanes, segmentBlocks);
+        if (usable <= refsSize) {
+            return 0;
+        }
+        usable -= refsSize;
+    }
+
+    /* the input and output blocks are staged in host memory: */
+    uint64_t jobSize = static_cast<uint64_t>(lanes) * segmentBlocks
+            * ARGON2_SYNC_POINTS * ARGON2_BLOCK_SIZE;
+    return static_cast<size_t>(std::min<uint64_t>(
+            usable / jobSize, std::numeric_limits<size_t>::max()));
+}
+
 KernelRunner::KernelRunner(uint32_t type, uint32_t version, uint32_t passes,
                            uint32_t lanes, uint32_t segmentBlocks,
                            size_t batchSize, bool bySegment, bool precompute)
@@ -826,12 +867,7 @@ KernelRunner::KernelRunner(uint32_t type, uint32_t version, uint32_t passes,
     CudaException::check(cudaStreamCreate(&stream));
 
     if ((type == ARGON2_I || type == ARGON2_ID) && precompute) {
-        uint32_t segments =
-                type == ARGON2_ID
-                ? lanes * (ARGON2_SYNC_POINTS / 2)
-                : passes * lanes * ARGON2_SYNC_POINTS;
-
-        size_t refsSize = segments * segmentBlocks * sizeof(struct ref);
+        size_t refsSize = getRefsSize(type, passes, lanes, segmentBlocks);
 
 #ifndef NDEBUG
         std::cerr << "[INFO] Allocating " << refsSize << " bytes for refs..."
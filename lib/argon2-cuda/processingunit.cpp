@@ -1,8 +1,14 @@
 #include "processingunit.h"
 
+#include "argon2-gpu-common/hostbatch.h"
+#include "argon2-gpu-common/tuningcache.h"
+
 #include "cudaexception.h"
 
 #include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #ifndef NDEBUG
 #include <iostream>
 #endif
@@ -24,6 +30,40 @@ static bool isPowerOfTwo(std::size_t x)
     return (x & (x - 1)) == 0;
 }
 
+/* A cached result is only trusted if the runner accepts it: */
+static bool isValidTuning(const KernelRunner &runner, std::uint32_t lanes,
+                          const TuningResult &tuning)
+{
+    return tuning.lanesPerBlock >= runner.getMinLanesPerBlock()
+            && tuning.lanesPerBlock <= runner.getMaxLanesPerBlock()
+            && lanes % tuning.lanesPerBlock == 0
+            && tuning.jobsPerBlock >= runner.getMinJobsPerBlock()
+            && tuning.jobsPerBlock <= runner.getMaxJobsPerBlock()
+            && runner.getBatchSize() % tuning.jobsPerBlock == 0;
+}
+
+static void checkJobParams(const Argon2Params &unitParams,
+                           const Argon2Params &jobParams)
+{
+    if (jobParams.getTimeCost() != unitParams.getTimeCost()
+            || jobParams.getMemoryCost() != unitParams.getMemoryCost()
+            || jobParams.getLanes() != unitParams.getLanes()) {
+        throw std::logic_error("Job params do not match unit params!");
+    }
+}
+
+std::size_t ProcessingUnit::getMaxBatchSize(
+        const ProgramContext *programContext, const Argon2Params *params,
+        const Device *device, bool bySegment, bool precomputeRefs)
+{
+    setCudaDevice(device->getDeviceIndex());
+
+    return KernelRunner::getMaxBatchSize(
+                programContext->getArgon2Type(), params->getTimeCost(),
+                params->getLanes(), params->getSegmentBlocks(),
+                precomputeRefs);
+}
+
 ProcessingUnit::ProcessingUnit(
         const ProgramContext *programContext, const Argon2Params *params,
         const Device *device, std::size_t batchSize, bool bySegment,
@@ -39,8 +79,28 @@ ProcessingUnit::ProcessingUnit(
     setCudaDevice(device->getDeviceIndex());
 
     /* pre-fill first blocks with pseudo-random data: */
-    for (std::size_t i = 0; i < batchSize; i++) {
-        setPassword(i, NULL, 0);
+    std::vector<const void *> pws(batchSize, nullptr);
+    std::vector<std::size_t> pwSizes(batchSize, 0);
+    setPasswords(0, batchSize, pws.data(), pwSizes.data());
+
+    std::string mode = std::string(bySegment ? "by-segment" : "oneshot")
+            + (precomputeRefs ? ",precompute" : ",in-place");
+    std::string tuningKey = TuningCache::makeKey(
+                "cuda", device->getName(), *params,
+                programContext->getArgon2Type(),
+                programContext->getArgon2Version(), batchSize, mode);
+
+    TuningResult tuning;
+    if (TuningCache::instance().lookup(tuningKey, tuning)
+            && isValidTuning(runner, params->getLanes(), tuning)) {
+        bestLanesPerBlock = tuning.lanesPerBlock;
+        bestJobsPerBlock = tuning.jobsPerBlock;
+#ifndef NDEBUG
+        std::cerr << "[INFO] Using cached tuning: " << bestLanesPerBlock
+                  << " lanes per block, " << bestJobsPerBlock
+                  << " jobs per block." << std::endl;
+#endif
+        return;
     }
 
     if (runner.getMaxLanesPerBlock() > runner.getMinLanesPerBlock()
@@ -120,6 +180,9 @@ ProcessingUnit::ProcessingUnit(
                   << " jobs per block." << std::endl;
 #endif
     }
+
+    TuningCache::instance().store(
+                tuningKey, TuningResult { bestLanesPerBlock, bestJobsPerBlock });
 }
 
 void ProcessingUnit::setPassword(std::size_t index, const void *pw,
@@ -135,6 +198,67 @@ void ProcessingUnit::getHash(std::size_t index, void *hash)
     params->finalize(hash, runner.getOutputMemory(index));
 }
 
+void ProcessingUnit::setPassword(std::size_t index,
+                                 const Argon2Params &jobParams,
+                                 const void *pw, std::size_t pwSize)
+{
+    checkJobParams(*params, jobParams);
+
+    jobParams.fillFirstBlocks(runner.getInputMemory(index), pw, pwSize,
+                              programContext->getArgon2Type(),
+                              programContext->getArgon2Version());
+}
+
+void ProcessingUnit::getHash(std::size_t index, const Argon2Params &jobParams,
+                             void *hash)
+{
+    checkJobParams(*params, jobParams);
+
+    jobParams.finalize(hash, runner.getOutputMemory(index));
+}
+
+void ProcessingUnit::setPasswords(std::size_t begin, std::size_t end,
+                                  const void *const *pws,
+                                  const std::size_t *pwSizes,
+                                  const Argon2Params *const *jobParams)
+{
+    if (begin > end || end > runner.getBatchSize()) {
+        throw std::logic_error("Invalid job range!");
+    }
+
+    std::vector<void *> memories(end - begin);
+    for (std::size_t i = 0; i < end - begin; i++) {
+        if (jobParams != nullptr) {
+            checkJobParams(*params, *jobParams[i]);
+        }
+        memories[i] = runner.getInputMemory(begin + i);
+    }
+
+    fillInputs(*params, jobParams, memories.data(), pws, pwSizes,
+               end - begin, programContext->getArgon2Type(),
+               programContext->getArgon2Version(), false);
+}
+
+void ProcessingUnit::getHashes(std::size_t begin, std::size_t end,
+                               void *const *hashes,
+                               const Argon2Params *const *jobParams)
+{
+    if (begin > end || end > runner.getBatchSize()) {
+        throw std::logic_error("Invalid job range!");
+    }
+
+    std::vector<const void *> memories(end - begin);
+    for (std::size_t i = 0; i < end - begin; i++) {
+        if (jobParams != nullptr) {
+            checkJobParams(*params, *jobParams[i]);
+        }
+        memories[i] = runner.getOutputMemory(begin + i);
+    }
+
+    readOutputs(*params, jobParams, hashes, memories.data(), end - begin,
+                false);
+}
+
 void ProcessingUnit::beginProcessing()
 {
     setCudaDevice(device->getDeviceIndex());
@@ -4,6 +4,7 @@
 
 #include <cstring>
 #include <algorithm>
+#include <vector>
 
 #ifdef DEBUG
 #include <cstdio>
@@ -11,6 +12,12 @@
 
 namespace argon2 {
 
+/* Batch digests are computed over this many messages at a time, so that
+ * their buffers stay in the cache: */
+enum {
+    DIGEST_CHUNK = 64,
+};
+
 static void store32(void *dst, std::uint32_t v)
 {
     auto out = static_cast<std::uint8_t *>(dst);
@@ -76,6 +83,61 @@ void Argon2Params::digestLong(void *out, std::size_t outLen,
     }
 }
 
+void Argon2Params::digestLong(void *const *outs, std::size_t outLen,
+                              const void *const *ins, std::size_t inLen,
+                              std::size_t count)
+{
+    std::size_t prefixedLen = sizeof(std::uint32_t) + inLen;
+    std::vector<std::uint8_t> prefixed(DIGEST_CHUNK * prefixedLen);
+    std::vector<std::uint8_t> buffers(DIGEST_CHUNK * Blake2b::OUT_BYTES);
+    std::vector<const void *> bufferIns(DIGEST_CHUNK);
+    std::vector<void *> bufferOuts(DIGEST_CHUNK), bouts(DIGEST_CHUNK);
+
+    for (std::size_t start = 0; start < count; start += DIGEST_CHUNK) {
+        std::size_t n = std::min<std::size_t>(DIGEST_CHUNK, count - start);
+
+        for (std::size_t i = 0; i < n; i++) {
+            std::uint8_t *message = prefixed.data() + i * prefixedLen;
+            store32(message, static_cast<std::uint32_t>(outLen));
+            std::memcpy(message + sizeof(std::uint32_t), ins[start + i], inLen);
+            bufferIns[i] = message;
+
+            bufferOuts[i] = buffers.data() + i * Blake2b::OUT_BYTES;
+            bouts[i] = outs[start + i];
+        }
+
+        if (outLen <= Blake2b::OUT_BYTES) {
+            Blake2b::hashMany(bouts.data(), outLen, bufferIns.data(),
+                              prefixedLen, n);
+            continue;
+        }
+
+        Blake2b::hashMany(bufferOuts.data(), Blake2b::OUT_BYTES,
+                          bufferIns.data(), prefixedLen, n);
+        for (std::size_t i = 0; i < n; i++) {
+            std::memcpy(bouts[i], bufferOuts[i], Blake2b::OUT_BYTES / 2);
+            bouts[i] = static_cast<std::uint8_t *>(bouts[i])
+                    + Blake2b::OUT_BYTES / 2;
+        }
+
+        /* the buffers are hashed in place (see Blake2b::hashMany()): */
+        std::size_t toProduce = outLen - Blake2b::OUT_BYTES / 2;
+        while (toProduce > Blake2b::OUT_BYTES) {
+            Blake2b::hashMany(bufferOuts.data(), Blake2b::OUT_BYTES,
+                              bufferOuts.data(), Blake2b::OUT_BYTES, n);
+            for (std::size_t i = 0; i < n; i++) {
+                std::memcpy(bouts[i], bufferOuts[i], Blake2b::OUT_BYTES / 2);
+                bouts[i] = static_cast<std::uint8_t *>(bouts[i])
+                        + Blake2b::OUT_BYTES / 2;
+            }
+            toProduce -= Blake2b::OUT_BYTES / 2;
+        }
+
+        Blake2b::hashMany(bouts.data(), toProduce, bufferOuts.data(),
+                          Blake2b::OUT_BYTES, n);
+    }
+}
+
 void Argon2Params::initialHash(
         void *out, const void *pwd, std::size_t pwdLen,
         Type type, Version version) const
@@ -191,5 +253,78 @@ void Argon2Params::finalize(void *out, const void *memory) const
     digestLong(out, outLen, &xored, ARGON2_BLOCK_SIZE);
 }
 
+void Argon2Params::fillFirstBlocks(
+        void *const *memories, const void *const *pwds,
+        const std::size_t *pwdLens, std::size_t count,
+        Type type, Version version) const
+{
+    std::vector<std::uint8_t> hashes(count * ARGON2_PREHASH_DIGEST_LENGTH);
+    std::vector<const void *> hashPtrs(count);
+    for (std::size_t i = 0; i < count; i++) {
+        std::uint8_t *hash = hashes.data() + i * ARGON2_PREHASH_DIGEST_LENGTH;
+        initialHash(hash, pwds[i], pwdLens[i], type, version);
+        hashPtrs[i] = hash;
+    }
+    fillFirstBlocks(memories, hashPtrs.data(), count);
+}
+
+void Argon2Params::fillFirstBlocks(
+        void *const *memories, const void *const *initialHashes,
+        std::size_t count) const
+{
+    /* the first two blocks of all lanes of all jobs are digests of
+     * equal-length seeds, so they can all be hashed side by side: */
+    std::size_t jobBlocks = 2 * lanes;
+    std::vector<std::uint8_t> seeds(
+                count * jobBlocks * ARGON2_PREHASH_SEED_LENGTH);
+    std::vector<const void *> ins(count * jobBlocks);
+    std::vector<void *> outs(count * jobBlocks);
+
+    for (std::size_t i = 0; i < count; i++) {
+        auto bmemory = static_cast<std::uint8_t *>(memories[i]);
+        for (std::uint32_t b = 0; b < 2; b++) {
+            for (std::uint32_t l = 0; l < lanes; l++) {
+                std::size_t k = i * jobBlocks + b * lanes + l;
+                std::uint8_t *seed = seeds.data()
+                        + k * ARGON2_PREHASH_SEED_LENGTH;
+                std::memcpy(seed, initialHashes[i],
+                            ARGON2_PREHASH_DIGEST_LENGTH);
+                store32(seed + ARGON2_PREHASH_DIGEST_LENGTH, b);
+                store32(seed + ARGON2_PREHASH_DIGEST_LENGTH + 4, l);
+
+                ins[k] = seed;
+                outs[k] = bmemory + (b * lanes + l) * ARGON2_BLOCK_SIZE;
+            }
+        }
+    }
+
+    digestLong(outs.data(), ARGON2_BLOCK_SIZE, ins.data(),
+               ARGON2_PREHASH_SEED_LENGTH, count * jobBlocks);
+}
+
+void Argon2Params::finalize(void *const *outs, const void *const *memories,
+                            std::size_t count) const
+{
+    struct block {
+        std::uint64_t v[ARGON2_BLOCK_SIZE / 8];
+    };
+
+    std::vector<block> xored(count);
+    std::vector<const void *> ins(count);
+    for (std::size_t i = 0; i < count; i++) {
+        auto cursor = static_cast<const block *>(memories[i]);
+        xored[i] = *cursor;
+        for (std::uint32_t l = 1; l < lanes; l++) {
+            ++cursor;
+            for (std::size_t k = 0; k < ARGON2_BLOCK_SIZE / 8; k++) {
+                xored[i].v[k] ^= cursor->v[k];
+            }
+        }
+        ins[i] = &xored[i];
+    }
+
+    digestLong(outs, outLen, ins.data(), ARGON2_BLOCK_SIZE, count);
+}
+
 } // namespace argon2
 
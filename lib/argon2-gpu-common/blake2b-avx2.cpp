@@ -0,0 +1,137 @@
+#include "blake2b-multi.h"
+
+#ifdef __AVX2__
+
+#include <cstring>
+#include <immintrin.h>
+
+namespace argon2 {
+
+enum {
+    WIDTH = 4,
+};
+
+#define ROTR32(x) _mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define ROTR24(x) _mm256_shuffle_epi8((x), _mm256_setr_epi8( \
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, \
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10))
+#define ROTR16(x) _mm256_shuffle_epi8((x), _mm256_setr_epi8( \
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, \
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9))
+#define ROTR63(x) _mm256_xor_si256(_mm256_srli_epi64((x), 63), \
+                                   _mm256_add_epi64((x), (x)))
+
+#define G(m, r, i, a, b, c, d) \
+    do { \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, b), \
+                             m[BLAKE2B_SIGMA[r][2 * i + 0]]); \
+        d = ROTR32(_mm256_xor_si256(d, a)); \
+        c = _mm256_add_epi64(c, d); \
+        b = ROTR24(_mm256_xor_si256(b, c)); \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, b), \
+                             m[BLAKE2B_SIGMA[r][2 * i + 1]]); \
+        d = ROTR16(_mm256_xor_si256(d, a)); \
+        c = _mm256_add_epi64(c, d); \
+        b = ROTR63(_mm256_xor_si256(b, c)); \
+    } while (0)
+
+#define ROUND(m, v, r) \
+    do { \
+        G(m, r, 0, v[0], v[4], v[ 8], v[12]); \
+        G(m, r, 1, v[1], v[5], v[ 9], v[13]); \
+        G(m, r, 2, v[2], v[6], v[10], v[14]); \
+        G(m, r, 3, v[3], v[7], v[11], v[15]); \
+        G(m, r, 4, v[0], v[5], v[10], v[15]); \
+        G(m, r, 5, v[1], v[6], v[11], v[12]); \
+        G(m, r, 6, v[2], v[7], v[ 8], v[13]); \
+        G(m, r, 7, v[3], v[4], v[ 9], v[14]); \
+    } while (0)
+
+/* Word k of every message's block goes into vector k (i.e. the messages are
+ * transposed), so that lane j of each vector belongs to message j: */
+static void loadBlocks(__m256i m[16], const void *const *ins,
+                       std::size_t offset, std::size_t length)
+{
+    alignas(32) std::uint64_t words[16][WIDTH];
+    std::uint8_t block[Blake2b::BLOCK_BYTES] = {0};
+    for (std::size_t j = 0; j < WIDTH; j++) {
+        std::memcpy(block, static_cast<const std::uint8_t *>(ins[j]) + offset,
+                    length);
+        for (std::size_t k = 0; k < 16; k++) {
+            std::memcpy(&words[k][j], block + k * 8, 8);
+        }
+    }
+    for (std::size_t k = 0; k < 16; k++) {
+        m[k] = _mm256_load_si256(reinterpret_cast<const __m256i *>(words[k]));
+    }
+}
+
+void hashManyAvx2(void *const *outs, std::size_t outLen,
+                  const void *const *ins, std::size_t inLen)
+{
+    __m256i h[8], v[16], m[16];
+    for (std::size_t i = 0; i < 8; i++) {
+        h[i] = _mm256_set1_epi64x(static_cast<long long>(BLAKE2B_IV[i]));
+    }
+    h[0] = _mm256_xor_si256(h[0], _mm256_set1_epi64x(static_cast<long long>(
+            outLen | (UINT64_C(1) << 16) | (UINT64_C(1) << 24))));
+
+    std::size_t offset = 0;
+    for (;;) {
+        bool last = inLen - offset <= Blake2b::BLOCK_BYTES;
+        std::size_t length = last ? inLen - offset
+                                  : std::size_t(Blake2b::BLOCK_BYTES);
+        loadBlocks(m, ins, offset, length);
+        offset += length;
+
+        for (std::size_t i = 0; i < 8; i++) {
+            v[i] = h[i];
+        }
+        v[ 8] = _mm256_set1_epi64x(static_cast<long long>(BLAKE2B_IV[0]));
+        v[ 9] = _mm256_set1_epi64x(static_cast<long long>(BLAKE2B_IV[1]));
+        v[10] = _mm256_set1_epi64x(static_cast<long long>(BLAKE2B_IV[2]));
+        v[11] = _mm256_set1_epi64x(static_cast<long long>(BLAKE2B_IV[3]));
+        v[12] = _mm256_set1_epi64x(static_cast<long long>(
+                BLAKE2B_IV[4] ^ offset));
+        v[13] = _mm256_set1_epi64x(static_cast<long long>(BLAKE2B_IV[5]));
+        v[14] = _mm256_set1_epi64x(static_cast<long long>(
+                last ? ~BLAKE2B_IV[6] : BLAKE2B_IV[6]));
+        v[15] = _mm256_set1_epi64x(static_cast<long long>(BLAKE2B_IV[7]));
+
+        ROUND(m, v, 0);
+        ROUND(m, v, 1);
+        ROUND(m, v, 2);
+        ROUND(m, v, 3);
+        ROUND(m, v, 4);
+        ROUND(m, v, 5);
+        ROUND(m, v, 6);
+        ROUND(m, v, 7);
+        ROUND(m, v, 8);
+        ROUND(m, v, 9);
+        ROUND(m, v, 10);
+        ROUND(m, v, 11);
+
+        for (std::size_t i = 0; i < 8; i++) {
+            h[i] = _mm256_xor_si256(h[i], _mm256_xor_si256(v[i], v[i + 8]));
+        }
+        if (last) {
+            break;
+        }
+    }
+
+    alignas(32) std::uint64_t words[8][WIDTH];
+    for (std::size_t i = 0; i < 8; i++) {
+        _mm256_store_si256(reinterpret_cast<__m256i *>(words[i]), h[i]);
+    }
+    for (std::size_t j = 0; j < WIDTH; j++) {
+        std::uint8_t digest[Blake2b::OUT_BYTES];
+        for (std::size_t i = 0; i < 8; i++) {
+            std::memcpy(digest + i * 8, &words[i][j], 8);
+        }
+        std::memcpy(outs[j], digest, outLen);
+    }
+}
+
+} // namespace argon2
+
+#endif // __AVX2__
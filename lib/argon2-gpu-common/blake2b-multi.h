@@ -0,0 +1,41 @@
+#ifndef ARGON2_BLAKE2B_MULTI_H
+#define ARGON2_BLAKE2B_MULTI_H
+
+#include "blake2b.h"
+
+namespace argon2 {
+
+static const std::uint64_t BLAKE2B_IV[8] = {
+    UINT64_C(0x6a09e667f3bcc908), UINT64_C(0xbb67ae8584caa73b),
+    UINT64_C(0x3c6ef372fe94f82b), UINT64_C(0xa54ff53a5f1d36f1),
+    UINT64_C(0x510e527fade682d1), UINT64_C(0x9b05688c2b3e6c1f),
+    UINT64_C(0x1f83d9abfb41bd6b), UINT64_C(0x5be0cd19137e2179)
+};
+
+static const unsigned int BLAKE2B_SIGMA[12][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+};
+
+/* The multi-buffer variants of Blake2b::hashMany(), which hash exactly 4
+ * (AVX2) or 8 (AVX-512F) messages, one per 64-bit lane of a vector. They are
+ * only compiled on x86 and must only be called when the CPU supports them
+ * (see Blake2b::getMultiWidth()): */
+void hashManyAvx2(void *const *outs, std::size_t outLen,
+                  const void *const *ins, std::size_t inLen);
+void hashManyAvx512f(void *const *outs, std::size_t outLen,
+                     const void *const *ins, std::size_t inLen);
+
+} // namespace argon2
+
+#endif // ARGON2_BLAKE2B_MULTI_H
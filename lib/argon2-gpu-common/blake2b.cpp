@@ -1,40 +1,19 @@
 #include "blake2b.h"
+#include "blake2b-multi.h"
 
 #include <cstring>
 
 namespace argon2 {
 
-static const std::uint64_t blake2b_IV[8] = {
-    UINT64_C(0x6a09e667f3bcc908), UINT64_C(0xbb67ae8584caa73b),
-    UINT64_C(0x3c6ef372fe94f82b), UINT64_C(0xa54ff53a5f1d36f1),
-    UINT64_C(0x510e527fade682d1), UINT64_C(0x9b05688c2b3e6c1f),
-    UINT64_C(0x1f83d9abfb41bd6b), UINT64_C(0x5be0cd19137e2179)
-};
-
-static const unsigned int blake2b_sigma[12][16] = {
-    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
-    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
-    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
-    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
-    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
-    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
-    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
-    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
-    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
-    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
-    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
-    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
-};
-
 #define rotr64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
 
 #define G(m, r, i, a, b, c, d) \
     do { \
-        a = a + b + m[blake2b_sigma[r][2 * i + 0]]; \
+        a = a + b + m[BLAKE2B_SIGMA[r][2 * i + 0]]; \
         d = rotr64(d ^ a, 32); \
         c = c + d; \
         b = rotr64(b ^ c, 24); \
-        a = a + b + m[blake2b_sigma[r][2 * i + 1]]; \
+        a = a + b + m[BLAKE2B_SIGMA[r][2 * i + 1]]; \
         d = rotr64(d ^ a, 16); \
         c = c + d; \
         b = rotr64(b ^ c, 63); \
@@ -84,7 +63,7 @@ void Blake2b::init(std::size_t outlen)
     t[1] = t[0] = 0;
     bufLen = 0;
 
-    std::memcpy(h, blake2b_IV, sizeof(h));
+    std::memcpy(h, BLAKE2B_IV, sizeof(h));
 
     h[0] ^= static_cast<std::uint64_t>(outlen) |
             (UINT64_C(1) << 16) | (UINT64_C(1) << 24);
@@ -122,14 +101,14 @@ void Blake2b::compress(const void *block, std::uint64_t f0)
     v[ 5] = h[5];
     v[ 6] = h[6];
     v[ 7] = h[7];
-    v[ 8] = blake2b_IV[0];
-    v[ 9] = blake2b_IV[1];
-    v[10] = blake2b_IV[2];
-    v[11] = blake2b_IV[3];
-    v[12] = blake2b_IV[4] ^ t[0];
-    v[13] = blake2b_IV[5] ^ t[1];
-    v[14] = blake2b_IV[6] ^ f0;
-    v[15] = blake2b_IV[7];
+    v[ 8] = BLAKE2B_IV[0];
+    v[ 9] = BLAKE2B_IV[1];
+    v[10] = BLAKE2B_IV[2];
+    v[11] = BLAKE2B_IV[3];
+    v[12] = BLAKE2B_IV[4] ^ t[0];
+    v[13] = BLAKE2B_IV[5] ^ t[1];
+    v[14] = BLAKE2B_IV[6] ^ f0;
+    v[15] = BLAKE2B_IV[7];
 
     ROUND(m, v, 0);
     ROUND(m, v, 1);
@@ -202,4 +181,50 @@ void Blake2b::final(void *out, std::size_t outLen)
     std::memcpy(out, buffer, outLen);
 }
 
+static std::size_t detectMultiWidth()
+{
+#ifdef ARGON2_GPU_COMMON_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return 8;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return 4;
+    }
+#endif
+    return 1;
+}
+
+std::size_t Blake2b::getMultiWidth()
+{
+    static const std::size_t width = detectMultiWidth();
+    return width;
+}
+
+void Blake2b::hashMany(void *const *outs, std::size_t outLen,
+                       const void *const *ins, std::size_t inLen,
+                       std::size_t count)
+{
+    std::size_t i = 0;
+#ifdef ARGON2_GPU_COMMON_X86_SIMD
+    std::size_t width = getMultiWidth();
+    if (width >= 8) {
+        for (; count - i >= 8; i += 8) {
+            hashManyAvx512f(outs + i, outLen, ins + i, inLen);
+        }
+    }
+    if (width >= 4) {
+        for (; count - i >= 4; i += 4) {
+            hashManyAvx2(outs + i, outLen, ins + i, inLen);
+        }
+    }
+#endif
+    Blake2b blake;
+    for (; i < count; i++) {
+        blake.init(outLen);
+        blake.update(ins[i], inLen);
+        blake.final(outs[i], outLen);
+    }
+}
+
 } // namespace argon2
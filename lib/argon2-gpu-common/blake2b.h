@@ -1,6 +1,7 @@
 #ifndef ARGON2_BLAKE2B_H
 #define ARGON2_BLAKE2B_H
 
+#include <cstddef>
 #include <cstdint>
 
 namespace argon2 {
@@ -28,6 +29,18 @@ public:
     void init(std::size_t outlen);
     void update(const void *in, std::size_t inLen);
     void final(void *out, std::size_t outLen);
+
+    /* How many messages hashMany() hashes at once (one per 64-bit SIMD
+     * lane: 8 with AVX-512F, 4 with AVX2, 1 without SIMD support): */
+    static std::size_t getMultiWidth();
+
+    /* Computes the outLen-byte (at most OUT_BYTES) digests of count messages
+     * of the same length inLen, getMultiWidth() of them at a time. Each
+     * output is written only after its input has been read, so outs[i] may
+     * point to ins[i]: */
+    static void hashMany(void *const *outs, std::size_t outLen,
+                         const void *const *ins, std::size_t inLen,
+                         std::size_t count);
 };
 
 } // namespace argon2
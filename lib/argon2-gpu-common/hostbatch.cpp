@@ -0,0 +1,88 @@
+#include "hostbatch.h"
+
+#include "threadpool.h"
+
+#include <cstring>
+#include <vector>
+
+namespace argon2 {
+
+/* Large enough to fill the SIMD lanes of Blake2b::hashMany() even at p=1,
+ * small enough to keep all threads busy on batches of a few hundred jobs: */
+enum {
+    JOBS_PER_CHUNK = 16,
+};
+
+static const Argon2Params &getJobParams(const Argon2Params &params,
+                                        const Argon2Params *const *jobParams,
+                                        std::size_t i)
+{
+    return jobParams != nullptr ? *jobParams[i] : params;
+}
+
+void fillInputs(const Argon2Params &params,
+                const Argon2Params *const *jobParams,
+                void *const *memories, const void *const *pws,
+                const std::size_t *pwSizes, std::size_t count,
+                Type type, Version version, bool initialHashOnly)
+{
+    ThreadPool::instance().run(
+                count, JOBS_PER_CHUNK,
+                [&](std::size_t begin, std::size_t end) {
+        if (initialHashOnly) {
+            for (std::size_t i = begin; i < end; i++) {
+                getJobParams(params, jobParams, i).initialHash(
+                            memories[i], pws[i], pwSizes[i], type, version);
+            }
+            return;
+        }
+
+        std::uint8_t hashes[JOBS_PER_CHUNK][ARGON2_PREHASH_DIGEST_LENGTH];
+        const void *hashPtrs[JOBS_PER_CHUNK];
+        for (std::size_t i = begin; i < end; i++) {
+            getJobParams(params, jobParams, i).initialHash(
+                        hashes[i - begin], pws[i], pwSizes[i], type, version);
+            hashPtrs[i - begin] = hashes[i - begin];
+        }
+        /* only the lanes matter from here on: */
+        params.fillFirstBlocks(memories + begin, hashPtrs, end - begin);
+    });
+}
+
+void readOutputs(const Argon2Params &params,
+                 const Argon2Params *const *jobParams,
+                 void *const *hashes, const void *const *memories,
+                 std::size_t count, bool tagsOnly)
+{
+    ThreadPool::instance().run(
+                count, JOBS_PER_CHUNK,
+                [&](std::size_t begin, std::size_t end) {
+        if (tagsOnly) {
+            for (std::size_t i = begin; i < end; i++) {
+                std::memcpy(hashes[i], memories[i],
+                            getJobParams(params, jobParams, i)
+                            .getOutputLength());
+            }
+            return;
+        }
+
+        /* only the lanes and the output length matter, so each run of jobs
+         * with the same output length is finalized at once: */
+        std::size_t runBegin = begin;
+        while (runBegin < end) {
+            const Argon2Params &runParams =
+                    getJobParams(params, jobParams, runBegin);
+            std::size_t runEnd = runBegin + 1;
+            while (runEnd < end
+                   && getJobParams(params, jobParams, runEnd).getOutputLength()
+                   == runParams.getOutputLength()) {
+                runEnd++;
+            }
+            runParams.finalize(hashes + runBegin, memories + runBegin,
+                               runEnd - runBegin);
+            runBegin = runEnd;
+        }
+    });
+}
+
+} // namespace argon2
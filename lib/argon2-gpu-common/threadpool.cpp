@@ -0,0 +1,110 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace argon2 {
+
+ThreadPool::ThreadPool()
+    : workers(), mutex(), startCond(), doneCond(), tasks(), stopping(false)
+{
+    /* the thread calling run() does its share of the work, too: */
+    std::size_t threads = std::thread::hardware_concurrency();
+    for (std::size_t i = 1; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::runWorker, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    startCond.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool &ThreadPool::instance()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::runChunk(std::unique_lock<std::mutex> &lock, Task &task)
+{
+    std::size_t begin = task.next;
+    std::size_t end = begin + std::min(task.chunkSize, task.count - begin);
+    task.next = end;
+    if (end == task.count) {
+        /* no more chunks to hand out: */
+        for (auto it = tasks.begin(); it != tasks.end(); ++it) {
+            if (*it == &task) {
+                tasks.erase(it);
+                break;
+            }
+        }
+    }
+
+    lock.unlock();
+    std::exception_ptr error;
+    try {
+        (*task.body)(begin, end);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    lock.lock();
+
+    if (error && !task.error) {
+        task.error = error;
+    }
+    if (--task.pendingChunks == 0) {
+        doneCond.notify_all();
+    }
+}
+
+void ThreadPool::runWorker()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        startCond.wait(lock, [&] { return stopping || !tasks.empty(); });
+        if (stopping) {
+            return;
+        }
+        runChunk(lock, *tasks.front());
+    }
+}
+
+void ThreadPool::run(std::size_t count, std::size_t chunkSize,
+                     const Body &body)
+{
+    if (count == 0) {
+        return;
+    }
+    chunkSize = std::max<std::size_t>(chunkSize, 1);
+
+    Task task;
+    task.body = &body;
+    task.count = count;
+    task.chunkSize = chunkSize;
+    task.next = 0;
+    task.pendingChunks = (count + chunkSize - 1) / chunkSize;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    tasks.push_back(&task);
+    if (task.pendingChunks > 1) {
+        startCond.notify_all();
+    }
+
+    while (task.next < task.count) {
+        runChunk(lock, task);
+    }
+    doneCond.wait(lock, [&] { return task.pendingChunks == 0; });
+
+    if (task.error) {
+        std::rethrow_exception(task.error);
+    }
+}
+
+} // namespace argon2
@@ -0,0 +1,192 @@
+#include "tuningcache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef NDEBUG
+#include <iostream>
+#endif
+
+namespace argon2 {
+
+/* Same directory as the OpenCL program cache (see KernelLoader): */
+static std::string getDefaultPath()
+{
+    const char *dir = std::getenv("ARGON2_GPU_CACHE_DIR");
+    if (dir != nullptr) {
+        /* empty value disables the cache: */
+        return *dir != '\0' ? std::string(dir) + "/tuning.txt" : std::string();
+    }
+
+    dir = std::getenv("XDG_CACHE_HOME");
+    if (dir != nullptr && *dir != '\0') {
+        return std::string(dir) + "/argon2-gpu/tuning.txt";
+    }
+
+    dir = std::getenv("HOME");
+    if (dir != nullptr && *dir != '\0') {
+        return std::string(dir) + "/.cache/argon2-gpu/tuning.txt";
+    }
+    return std::string();
+}
+
+static bool makeParentDirectories(const std::string &path)
+{
+    for (std::size_t pos = 1; pos < path.size(); pos++) {
+        if (path[pos] != '/') {
+            continue;
+        }
+        std::string prefix = path.substr(0, pos);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Keeps the key on one line and free of the tab that ends it: */
+static std::string sanitize(const std::string &s)
+{
+    std::string res = s;
+    for (auto &c : res) {
+        if (c == '\t' || c == '\n' || c == '\r') {
+            c = ' ';
+        }
+    }
+    return res;
+}
+
+TuningCache::TuningCache()
+    : mutex(), path(getDefaultPath()), retune(false), loaded(false),
+      entries()
+{
+}
+
+TuningCache &TuningCache::instance()
+{
+    static TuningCache cache;
+    return cache;
+}
+
+std::string TuningCache::makeKey(const std::string &backend,
+                                 const std::string &deviceName,
+                                 const Argon2Params &params,
+                                 Type type, Version version,
+                                 std::size_t batchSize,
+                                 const std::string &mode)
+{
+    std::ostringstream key;
+    key << backend << "|" << sanitize(deviceName)
+        << "|type=" << type << "|v=" << std::hex << version << std::dec
+        << "|m=" << params.getMemoryCost() << "|t=" << params.getTimeCost()
+        << "|p=" << params.getLanes() << "|batch=" << batchSize
+        << "|" << mode;
+    return key.str();
+}
+
+void TuningCache::setPath(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->path = path;
+    loaded = false;
+    entries.clear();
+}
+
+std::string TuningCache::getPath()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return path;
+}
+
+void TuningCache::setRetune(bool retune)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->retune = retune;
+}
+
+void TuningCache::load(std::map<std::string, TuningResult> &into) const
+{
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::size_t tab = line.rfind('\t');
+        if (tab == std::string::npos) {
+            continue;
+        }
+
+        std::istringstream values(line.substr(tab + 1));
+        TuningResult result;
+        if (values >> result.lanesPerBlock >> result.jobsPerBlock) {
+            into[line.substr(0, tab)] = result;
+        }
+    }
+}
+
+bool TuningCache::lookup(const std::string &key, TuningResult &result)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (path.empty() || retune) {
+        return false;
+    }
+    if (!loaded) {
+        load(entries);
+        loaded = true;
+    }
+
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return false;
+    }
+    result = it->second;
+    return true;
+}
+
+void TuningCache::store(const std::string &key, const TuningResult &result)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (path.empty()) {
+        return;
+    }
+
+    /* pick up what other processes stored in the meantime: */
+    load(entries);
+    loaded = true;
+    entries[key] = result;
+
+    if (!makeParentDirectories(path)) {
+        return;
+    }
+
+    /* Write to a private file first and rename it into place, so that
+     * concurrent processes never see a partially written cache: */
+    std::string tmpPath = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        if (!file.is_open()) {
+            return;
+        }
+        for (const auto &entry : entries) {
+            file << entry.first << "\t" << entry.second.lanesPerBlock << " "
+                 << entry.second.jobsPerBlock << "\n";
+        }
+        if (!file) {
+            file.close();
+            std::remove(tmpPath.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+#ifndef NDEBUG
+        std::cerr << "[WARN] Failed to write the tuning cache " << path
+                  << std::endl;
+#endif
+        std::remove(tmpPath.c_str());
+    }
+}
+
+} // namespace argon2
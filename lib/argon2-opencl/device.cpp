@@ -31,6 +31,21 @@ std::string Device::getName() const
             + "' (" + device.getInfo<CL_DEVICE_VENDOR>() + ")";
 }
 
+std::uint64_t Device::getGlobalMemorySize() const
+{
+    return device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>();
+}
+
+std::uint64_t Device::getMaxAllocationSize() const
+{
+    return device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+}
+
+bool Device::hasHostUnifiedMemory() const
+{
+    return device.getInfo<CL_DEVICE_HOST_UNIFIED_MEMORY>() == CL_TRUE;
+}
+
 template<class T>
 static std::ostream &printBitfield(std::ostream &out, T value,
                                    const std::vector<std::pair<T, std::string>> &lookup)
@@ -3,14 +3,189 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace argon2 {
 namespace opencl {
 
-cl::Program KernelLoader::loadArgon2Program(
+/* Bump this whenever the layout of cache entries changes: */
+static const char CACHE_MAGIC[] = "argon2-gpu program cache v1";
+
+static std::uint64_t fnv1a64(const std::string &data)
+{
+    std::uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+static std::string toHex(std::uint64_t value)
+{
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string res(16, '0');
+    for (std::size_t i = 0; i < 16; i++) {
+        res[15 - i] = DIGITS[value & 0xf];
+        value >>= 4;
+    }
+    return res;
+}
+
+static bool makeDirectories(const std::string &path)
+{
+    for (std::size_t pos = 1; pos <= path.size(); pos++) {
+        if (pos != path.size() && path[pos] != '/') {
+            continue;
+        }
+        std::string prefix = path.substr(0, pos);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* The key identifies everything that can make a binary unusable: the exact
+ * device and driver, the build options and the kernel source itself. */
+static std::string makeCacheKey(const cl::Device &device,
+                                const std::string &buildOpts,
+                                const std::string &sourceText)
+{
+    cl::Platform platform(device.getInfo<CL_DEVICE_PLATFORM>());
+
+    std::ostringstream key;
+    key << CACHE_MAGIC << "\n";
+    key << "platform=" << platform.getInfo<CL_PLATFORM_NAME>() << "\n";
+    key << "platform-version=" << platform.getInfo<CL_PLATFORM_VERSION>() << "\n";
+    key << "device=" << device.getInfo<CL_DEVICE_NAME>() << "\n";
+    key << "device-version=" << device.getInfo<CL_DEVICE_VERSION>() << "\n";
+    key << "driver=" << device.getInfo<CL_DRIVER_VERSION>() << "\n";
+    key << "options=" << buildOpts << "\n";
+    key << "source=" << toHex(fnv1a64(sourceText)) << "\n";
+    return key.str();
+}
+
+static std::string makeCachePath(const std::string &cacheDirectory,
+                                 const std::string &key)
+{
+    return cacheDirectory + "/" + toHex(fnv1a64(key)) + ".bin";
+}
+
+/* Cache entry layout: the full key, a NUL byte, then the raw binary. Storing
+ * the key lets us reject the (unlikely) case of a file name collision. */
+static bool readCacheEntry(const std::string &path, const std::string &key,
+                           std::string &binary)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string contents {
+        std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>()
+    };
+    if (contents.size() <= key.size()
+            || contents.compare(0, key.size(), key) != 0
+            || contents[key.size()] != '\0') {
+        return false;
+    }
+    binary = contents.substr(key.size() + 1);
+    return !binary.empty();
+}
+
+static void writeCacheEntry(const std::string &cacheDirectory,
+                            const std::string &path, const std::string &key,
+                            const char *binary, std::size_t binarySize)
+{
+    static std::atomic<unsigned> counter { 0 };
+
+    if (!makeDirectories(cacheDirectory)) {
+        return;
+    }
+
+    /* Write to a private file first and rename it into place, so that
+     * concurrent processes never see a partially written entry: */
+    std::string tmpPath = path + ".tmp." + std::to_string(getpid())
+            + "." + std::to_string(counter++);
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return;
+        }
+        file.write(key.data(), key.size());
+        file.put('\0');
+        file.write(binary, binarySize);
+        if (!file) {
+            file.close();
+            std::remove(tmpPath.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+    }
+}
+
+static void storeBinaries(const cl::Program &prog,
+                          const std::string &cacheDirectory,
+                          const std::vector<std::string> &keys,
+                          const std::vector<cl::Device> &devices)
+{
+    auto progDevices = prog.getInfo<CL_PROGRAM_DEVICES>();
+    auto sizes = prog.getInfo<CL_PROGRAM_BINARY_SIZES>();
+
+    std::vector<std::vector<char>> storage(sizes.size());
+    std::vector<char *> binaries(sizes.size());
+    for (std::size_t i = 0; i < sizes.size(); i++) {
+        storage[i].resize(sizes[i]);
+        binaries[i] = storage[i].data();
+    }
+    prog.getInfo(CL_PROGRAM_BINARIES, &binaries);
+
+    for (std::size_t i = 0; i < devices.size(); i++) {
+        for (std::size_t k = 0; k < progDevices.size(); k++) {
+            if (progDevices[k]() != devices[i]() || sizes[k] == 0) {
+                continue;
+            }
+            writeCacheEntry(cacheDirectory,
+                            makeCachePath(cacheDirectory, keys[i]), keys[i],
+                            storage[k].data(), sizes[k]);
+        }
+    }
+}
+
+std::string KernelLoader::getDefaultCacheDirectory()
+{
+    const char *dir = std::getenv("ARGON2_GPU_CACHE_DIR");
+    if (dir != nullptr) {
+        /* empty value disables the cache: */
+        return dir;
+    }
+
+    dir = std::getenv("XDG_CACHE_HOME");
+    if (dir != nullptr && *dir != '\0') {
+        return std::string(dir) + "/argon2-gpu";
+    }
+
+    dir = std::getenv("HOME");
+    if (dir != nullptr && *dir != '\0') {
+        return std::string(dir) + "/.cache/argon2-gpu";
+    }
+    return std::string();
+}
+
+static cl::Program loadProgram(
         const cl::Context &context,
         const std::string &sourceDirectory,
-        Type type, Version version, bool debug)
+        const std::string &cacheDirectory,
+        Type type, Version version, const std::string &extraOpts, bool debug)
 {
     std::string sourcePath = sourceDirectory + "/argon2_kernel.cl";
     std::string sourceText;
@@ -28,10 +203,52 @@ cl::Program KernelLoader::loadArgon2Program(
     }
     buildOpts << "-DARGON2_TYPE=" << type << " ";
     buildOpts << "-DARGON2_VERSION=" << version << " ";
+    buildOpts << extraOpts;
+
+    std::string opts = buildOpts.str();
+    std::vector<cl::Device> devices = context.getInfo<CL_CONTEXT_DEVICES>();
+
+    /* Debug builds reference the source path, so never cache those: */
+    bool useCache = !debug && !cacheDirectory.empty();
+
+    std::vector<std::string> keys;
+    if (useCache) {
+        std::vector<std::string> binaryData;
+        for (auto &device : devices) {
+            keys.push_back(makeCacheKey(device, opts, sourceText));
+
+            std::string binary;
+            if (readCacheEntry(makeCachePath(cacheDirectory, keys.back()),
+                               keys.back(), binary)) {
+                binaryData.push_back(std::move(binary));
+            }
+        }
+
+        if (binaryData.size() == devices.size()) {
+            cl::Program::Binaries binaries;
+            for (auto &binary : binaryData) {
+                binaries.push_back({ binary.data(), binary.size() });
+            }
+            try {
+                cl::Program prog(context, devices, binaries);
+                prog.build(devices, opts.c_str());
+#ifndef NDEBUG
+                std::cerr << "[INFO] Loaded program binary from cache."
+                          << std::endl;
+#endif
+                return prog;
+            } catch (const cl::Error &err) {
+                /* stale or corrupt entry -- rebuild and overwrite it: */
+#ifndef NDEBUG
+                std::cerr << "[WARN] Cached program binary rejected (error "
+                          << err.err() << "), rebuilding..." << std::endl;
+#endif
+            }
+        }
+    }
 
     cl::Program prog(context, sourceText);
     try {
-        std::string opts = buildOpts.str();
         prog.build(opts.c_str());
     } catch (const cl::Error &) {
         std::cerr << "ERROR: Failed to build program:" << std::endl;
@@ -41,9 +258,55 @@ cl::Program KernelLoader::loadArgon2Program(
         }
         throw;
     }
+
+    if (useCache) {
+        try {
+            storeBinaries(prog, cacheDirectory, keys, devices);
+        } catch (const cl::Error &err) {
+            /* caching is best-effort: */
+#ifndef NDEBUG
+            std::cerr << "[WARN] Failed to cache program binary (error "
+                      << err.err() << ")." << std::endl;
+#endif
+        }
+    }
     return prog;
 }
 
+cl::Program KernelLoader::loadArgon2Program(
+        const cl::Context &context,
+        const std::string &sourceDirectory,
+        Type type, Version version, bool debug)
+{
+    return loadArgon2Program(context, sourceDirectory,
+                             getDefaultCacheDirectory(), type, version, debug);
+}
+
+cl::Program KernelLoader::loadArgon2Program(
+        const cl::Context &context,
+        const std::string &sourceDirectory,
+        const std::string &cacheDirectory,
+        Type type, Version version, bool debug)
+{
+    return loadProgram(context, sourceDirectory, cacheDirectory,
+                       type, version, std::string(), debug);
+}
+
+cl::Program KernelLoader::loadArgon2Program(
+        const cl::Context &context,
+        const std::string &sourceDirectory,
+        const std::string &cacheDirectory,
+        Type type, Version version, const Argon2Params &params, bool debug)
+{
+    std::stringstream specializeOpts;
+    specializeOpts << "-DARGON2_PASSES=" << params.getTimeCost() << " ";
+    specializeOpts << "-DARGON2_LANES=" << params.getLanes() << " ";
+    specializeOpts << "-DARGON2_SEGMENT_BLOCKS="
+                   << params.getSegmentBlocks() << " ";
+
+    return loadProgram(context, sourceDirectory, cacheDirectory,
+                       type, version, specializeOpts.str(), debug);
+}
+
 } // namespace opencl
 } // namespace argon2
-
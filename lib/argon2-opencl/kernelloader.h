@@ -3,6 +3,7 @@
 
 #include "opencl.h"
 #include "argon2-gpu-common/argon2-common.h"
+#include "argon2-gpu-common/argon2params.h"
 
 #include <string>
 
@@ -11,10 +12,35 @@ namespace opencl {
 
 namespace KernelLoader
 {
+    /* Returns $ARGON2_GPU_CACHE_DIR if set (an empty value disables
+     * caching), otherwise $XDG_CACHE_HOME/argon2-gpu or
+     * ~/.cache/argon2-gpu: */
+    std::string getDefaultCacheDirectory();
+
+    cl::Program loadArgon2Program(
+            const cl::Context &context,
+            const std::string &sourceDirectory,
+            Type type, Version version, bool debug = false);
+
+    /* Like above, but built program binaries are stored in and loaded from
+     * cacheDirectory (keyed by device, driver, build options and kernel
+     * source); pass an empty string to always build from source: */
     cl::Program loadArgon2Program(
             const cl::Context &context,
             const std::string &sourceDirectory,
+            const std::string &cacheDirectory,
             Type type, Version version, bool debug = false);
+
+    /* Like above, but with the time cost, lanes and segment blocks of
+     * params compiled into the program as constants, so that the compiler
+     * can fold them. The program may only run jobs with exactly these cost
+     * parameters. Specialized programs are cached like the generic ones: */
+    cl::Program loadArgon2Program(
+            const cl::Context &context,
+            const std::string &sourceDirectory,
+            const std::string &cacheDirectory,
+            Type type, Version version, const Argon2Params &params,
+            bool debug = false);
 };
 
 } // namespace opencl
@@ -1,5 +1,7 @@
 #include "kernelrunner.h"
 
+#include <algorithm>
+#include <limits>
 #include <stdexcept>
 
 #ifndef NDEBUG
@@ -32,38 +34,159 @@ static cl::size_t<3> makeSize3(std::size_t x, std::size_t y, std::size_t z)
     return res;
 }
 
+static std::size_t getRefsSize(Type type, const Argon2Params *params)
+{
+    std::uint32_t segments =
+            type == ARGON2_ID
+            ? params->getLanes() * (ARGON2_SYNC_POINTS / 2)
+            : params->getTimeCost() * params->getLanes() * ARGON2_SYNC_POINTS;
+
+    return std::size_t(segments) * params->getSegmentBlocks()
+            * sizeof(cl_uint) * 2;
+}
+
+std::size_t KernelRunner::getMaxBatchSize(
+        const ProgramContext *programContext, const Argon2Params *params,
+        const Device *device, bool precompute, std::size_t bufferCount,
+        bool deviceInitFinalize)
+{
+    if (bufferCount == 0) {
+        throw std::logic_error("Invalid bufferCount!");
+    }
+
+    std::uint64_t globalMemory = device->getGlobalMemorySize();
+    std::uint64_t usable = globalMemory - globalMemory / 10;
+
+    Type type = programContext->getArgon2Type();
+    if ((type == ARGON2_I || type == ARGON2_ID) && precompute) {
+        std::uint64_t refsSize = getRefsSize(type, params);
+        if (usable <= refsSize) {
+            return 0;
+        }
+        usable -= refsSize;
+    }
+
+    /* the staging buffers may live in device memory as well (there are
+     * none with zero-copy): */
+    bool zeroCopy = device->hasHostUnifiedMemory();
+    std::uint64_t memorySize = params->getMemorySize();
+    std::uint64_t jobSize = memorySize;
+    if (deviceInitFinalize) {
+        jobSize += (zeroCopy ? 1 : 2) * (ARGON2_PREHASH_DIGEST_LENGTH
+                                         + params->getOutputLength());
+        jobSize += 3 * sizeof(cl_uint);
+    } else if (!zeroCopy) {
+        jobSize += 3 * params->getLanes() * ARGON2_BLOCK_SIZE;
+    }
+
+    if (memorySize > device->getMaxAllocationSize()) {
+        return 0;
+    }
+    return static_cast<std::size_t>(std::min<std::uint64_t>(
+            usable / (bufferCount * jobSize),
+            std::numeric_limits<std::size_t>::max()));
+}
+
 KernelRunner::KernelRunner(const ProgramContext *programContext,
                            const Argon2Params *params, const Device *device,
-                           std::size_t batchSize, bool bySegment, bool precompute)
+                           std::size_t batchSize, bool bySegment, bool precompute,
+                           std::size_t bufferCount, bool deviceInitFinalize)
     : programContext(programContext), params(params), batchSize(batchSize),
       bySegment(bySegment), precompute(precompute),
-      memorySize(params->getMemorySize() * batchSize),
-      blocksIn(new std::uint8_t[batchSize * params->getLanes() * 2 * ARGON2_BLOCK_SIZE]),
-      blocksOut(new std::uint8_t[batchSize * params->getLanes() * ARGON2_BLOCK_SIZE])
+      deviceInitFinalize(deviceInitFinalize),
+      zeroCopy(device->hasHostUnifiedMemory()),
+      buffers(bufferCount),
+      targets(), targetCount(0), targetsVersion(0)
 {
+    if (bufferCount == 0) {
+        throw std::logic_error("Invalid bufferCount!");
+    }
+    if (!programContext->canRun(*params)) {
+        throw std::logic_error("Program is specialized for other params!");
+    }
+
+    /* Split the jobs evenly across as few memory buffers as the maximum
+     * allocation size allows: */
+    std::size_t jobMemorySize = params->getMemorySize();
+    std::uint64_t maxAllocation = device->getMaxAllocationSize();
+    std::size_t maxJobs = static_cast<std::size_t>(std::max<std::uint64_t>(
+            1, std::min<std::uint64_t>(maxAllocation / jobMemorySize,
+                                       batchSize)));
+    std::size_t memoryBufferCount = std::max<std::size_t>(
+                1, (batchSize + maxJobs - 1) / maxJobs);
+    jobsPerMemoryBuffer = (batchSize + memoryBufferCount - 1)
+            / memoryBufferCount;
+
     auto context = programContext->getContext();
     std::uint32_t passes = params->getTimeCost();
     std::uint32_t lanes = params->getLanes();
     std::uint32_t segmentBlocks = params->getSegmentBlocks();
 
+    uploadQueue = cl::CommandQueue(context, device->getCLDevice(),
+                                   CL_QUEUE_PROFILING_ENABLE);
     queue = cl::CommandQueue(context, device->getCLDevice(),
                              CL_QUEUE_PROFILING_ENABLE);
+    downloadQueue = cl::CommandQueue(context, device->getCLDevice(),
+                                     CL_QUEUE_PROFILING_ENABLE);
 
 #ifndef NDEBUG
-        std::cerr << "[INFO] Allocating " << memorySize << " bytes for memory..."
+    if (zeroCopy) {
+        std::cerr << "[INFO] Host-unified device, using zero-copy buffers."
                   << std::endl;
+    }
 #endif
 
-    memoryBuffer = cl::Buffer(context, CL_MEM_READ_WRITE, memorySize);
+    /* with zero-copy, the buffers the host works on are allocated in host
+     * memory by the runtime: */
+    cl_mem_flags hostFlags = zeroCopy ? CL_MEM_ALLOC_HOST_PTR : 0;
+    for (auto &set : buffers) {
+        for (std::size_t i = 0; i < memoryBufferCount; i++) {
+            std::size_t memorySize = jobMemorySize * getJobCount(i);
+#ifndef NDEBUG
+            std::cerr << "[INFO] Allocating " << memorySize
+                      << " bytes for memory..." << std::endl;
+#endif
+
+            set.memoryBuffers.push_back(cl::Buffer(
+                        context, CL_MEM_READ_WRITE
+                        | (deviceInitFinalize ? 0 : hostFlags), memorySize));
+        }
+
+        std::size_t inSize = batchSize * getInputSize();
+        std::size_t outSize = batchSize * getOutputSize();
+
+        if (deviceInitFinalize) {
+            set.seedsBuffer = cl::Buffer(context, CL_MEM_READ_ONLY | hostFlags,
+                                         inSize);
+            set.tagsBuffer = cl::Buffer(context, CL_MEM_WRITE_ONLY | hostFlags,
+                                        outSize);
+        }
+
+        if (zeroCopy) {
+            set.mappedMemory.assign(memoryBufferCount, nullptr);
+            mapBuffers(set, nullptr, nullptr);
+            continue;
+        }
+
+        set.stagingIn = cl::Buffer(context, CL_MEM_READ_ONLY
+                                   | CL_MEM_ALLOC_HOST_PTR, inSize);
+        set.stagingOut = cl::Buffer(context, CL_MEM_WRITE_ONLY
+                                    | CL_MEM_ALLOC_HOST_PTR, outSize);
+
+        set.blocksIn = static_cast<std::uint8_t *>(
+                    uploadQueue.enqueueMapBuffer(set.stagingIn, true,
+                                                 CL_MAP_WRITE, 0, inSize));
+        set.blocksOut = static_cast<std::uint8_t *>(
+                    downloadQueue.enqueueMapBuffer(set.stagingOut, true,
+                                                   CL_MAP_READ, 0, outSize));
+    }
+    if (zeroCopy) {
+        downloadQueue.finish();
+    }
 
     Type type = programContext->getArgon2Type();
     if ((type == ARGON2_I || type == ARGON2_ID) && precompute) {
-        std::uint32_t segments =
-                type == ARGON2_ID
-                ? lanes * (ARGON2_SYNC_POINTS / 2)
-                : passes * lanes * ARGON2_SYNC_POINTS;
-
-        std::size_t refsSize = segments * segmentBlocks * sizeof(cl_uint) * 2;
+        std::size_t refsSize = getRefsSize(type, params);
 
 #ifndef NDEBUG
         std::cerr << "[INFO] Allocating " << refsSize << " bytes for refs..."
@@ -88,7 +211,6 @@ KernelRunner::KernelRunner(const ProgramContext *programContext,
 
     kernel = cl::Kernel(programContext->getProgram(),
                         KERNEL_NAMES[precompute][bySegment]);
-    kernel.setArg<cl::Buffer>(1, memoryBuffer);
     if (precompute) {
         kernel.setArg<cl::Buffer>(2, refsBuffer);
         kernel.setArg<cl_uint>(3, passes);
@@ -99,6 +221,87 @@ KernelRunner::KernelRunner(const ProgramContext *programContext,
         kernel.setArg<cl_uint>(3, lanes);
         kernel.setArg<cl_uint>(4, segmentBlocks);
     }
+
+    if (deviceInitFinalize) {
+        initKernel = cl::Kernel(programContext->getProgram(),
+                                "argon2_init_kernel");
+        initKernel.setArg<cl_uint>(2, lanes);
+        initKernel.setArg<cl_uint>(3, segmentBlocks);
+
+        finalizeKernel = cl::Kernel(programContext->getProgram(),
+                                    "argon2_finalize_kernel");
+        finalizeKernel.setArg<cl_uint>(2, lanes);
+        finalizeKernel.setArg<cl_uint>(3, segmentBlocks);
+        finalizeKernel.setArg<cl_uint>(4, params->getOutputLength());
+
+        compareKernel = cl::Kernel(programContext->getProgram(),
+                                   "argon2_compare_kernel");
+        compareKernel.setArg<cl_uint>(5, params->getOutputLength());
+
+        for (auto &set : buffers) {
+            set.jobTargetsBuffer = cl::Buffer(context, CL_MEM_READ_ONLY,
+                                              batchSize * sizeof(cl_uint));
+            set.matchesBuffer = cl::Buffer(
+                        context, CL_MEM_READ_WRITE,
+                        (1 + 2 * batchSize) * sizeof(cl_uint));
+            set.jobTargets.assign(batchSize, ANY_TARGET);
+        }
+    }
+}
+
+void KernelRunner::setTargets(const void *tags, std::size_t count)
+{
+    if (!deviceInitFinalize) {
+        throw std::logic_error("Device comparison requires deviceInitFinalize!");
+    }
+    if (count >= ANY_TARGET) {
+        throw std::logic_error("Too many targets!");
+    }
+
+    auto bytes = static_cast<const std::uint8_t *>(tags);
+    targets.assign(bytes, bytes + count * params->getOutputLength());
+    targetCount = count;
+    targetsVersion++;
+}
+
+std::size_t KernelRunner::getInputSize() const
+{
+    if (deviceInitFinalize) {
+        return ARGON2_PREHASH_DIGEST_LENGTH;
+    }
+    return params->getLanes() * 2 * ARGON2_BLOCK_SIZE;
+}
+
+std::size_t KernelRunner::getOutputSize() const
+{
+    if (deviceInitFinalize) {
+        return params->getOutputLength();
+    }
+    return params->getLanes() * ARGON2_BLOCK_SIZE;
+}
+
+KernelRunner::~KernelRunner()
+{
+    try {
+        for (auto &set : buffers) {
+            if (zeroCopy) {
+                /* after the maps of the last run, on the same queue: */
+                unmapBuffers(set, downloadQueue, nullptr, nullptr);
+                continue;
+            }
+            if (set.blocksIn != nullptr) {
+                uploadQueue.enqueueUnmapMemObject(set.stagingIn, set.blocksIn);
+            }
+            if (set.blocksOut != nullptr) {
+                downloadQueue.enqueueUnmapMemObject(set.stagingOut,
+                                                    set.blocksOut);
+            }
+        }
+        uploadQueue.finish();
+        downloadQueue.finish();
+    } catch (const cl::Error &) {
+        /* nothing sensible to do in a destructor */
+    }
 }
 
 void KernelRunner::precomputeRefs()
@@ -129,34 +332,163 @@ void KernelRunner::precomputeRefs()
     queue.finish();
 }
 
-void KernelRunner::copyInputBlocks()
+void KernelRunner::mapBuffers(BufferSet &set,
+                              const std::vector<cl::Event> *waitList,
+                              cl::Event *event)
+{
+    /* the queue is in-order, so the last map signals the end of all: */
+    if (deviceInitFinalize) {
+        set.blocksIn = static_cast<std::uint8_t *>(
+                    downloadQueue.enqueueMapBuffer(
+                        set.seedsBuffer, false, CL_MAP_WRITE,
+                        0, batchSize * getInputSize(), waitList, nullptr));
+        set.blocksOut = static_cast<std::uint8_t *>(
+                    downloadQueue.enqueueMapBuffer(
+                        set.tagsBuffer, false, CL_MAP_READ,
+                        0, batchSize * getOutputSize(), nullptr, event));
+        return;
+    }
+
+    std::size_t count = set.memoryBuffers.size();
+    for (std::size_t i = 0; i < count; i++) {
+        set.mappedMemory[i] = static_cast<std::uint8_t *>(
+                    downloadQueue.enqueueMapBuffer(
+                        set.memoryBuffers[i], false,
+                        CL_MAP_READ | CL_MAP_WRITE,
+                        0, params->getMemorySize() * getJobCount(i),
+                        i == 0 ? waitList : nullptr,
+                        i == count - 1 ? event : nullptr));
+    }
+}
+
+void KernelRunner::unmapBuffers(BufferSet &set, cl::CommandQueue &queue,
+                                const std::vector<cl::Event> *waitList,
+                                cl::Event *event)
+{
+    if (deviceInitFinalize) {
+        queue.enqueueUnmapMemObject(set.seedsBuffer, set.blocksIn,
+                                    waitList, nullptr);
+        queue.enqueueUnmapMemObject(set.tagsBuffer, set.blocksOut,
+                                    nullptr, event);
+        return;
+    }
+
+    std::size_t count = set.memoryBuffers.size();
+    for (std::size_t i = 0; i < count; i++) {
+        queue.enqueueUnmapMemObject(set.memoryBuffers[i], set.mappedMemory[i],
+                                    i == 0 ? waitList : nullptr,
+                                    i == count - 1 ? event : nullptr);
+    }
+}
+
+void KernelRunner::copyInputBlocks(BufferSet &set)
 {
+    if (zeroCopy) {
+        /* the host wrote the input into the device buffers themselves, so
+         * they only have to be handed back (once the maps of the last run,
+         * on the download queue, are done): */
+        std::vector<cl::Event> waitList;
+        if (set.end() != nullptr) {
+            waitList.push_back(set.end);
+        }
+        unmapBuffers(set, uploadQueue, waitList.empty() ? nullptr : &waitList,
+                     &set.kernelStart);
+        return;
+    }
+    if (deviceInitFinalize) {
+        uploadQueue.enqueueWriteBuffer(set.seedsBuffer, false,
+                                       0, batchSize * getInputSize(),
+                                       set.blocksIn, nullptr, &set.kernelStart);
+        return;
+    }
+
     std::size_t jobSize = params->getMemorySize();
     std::size_t copySize = params->getLanes() * 2 * ARGON2_BLOCK_SIZE;
 
-    queue.enqueueWriteBufferRect(memoryBuffer, false,
-                                 makeSize3(0, 0, 0), makeSize3(0, 0, 0),
-                                 makeSize3(copySize, batchSize, 1),
-                                 jobSize, 0, copySize, 0, blocksIn.get());
+    /* the queue is in-order, so the last copy signals the end of all: */
+    for (std::size_t i = 0; i < set.memoryBuffers.size(); i++) {
+        uploadQueue.enqueueWriteBufferRect(
+                    set.memoryBuffers[i], false,
+                    makeSize3(0, 0, 0), makeSize3(0, getFirstJob(i), 0),
+                    makeSize3(copySize, getJobCount(i), 1),
+                    jobSize, 0, copySize, 0,
+                    set.blocksIn, nullptr, &set.kernelStart);
+    }
+}
+
+void KernelRunner::copyTargets(BufferSet &set)
+{
+    if (set.targetsVersion != targetsVersion) {
+        if (set.targetsCapacity < targets.size()) {
+            set.targetsBuffer = cl::Buffer(programContext->getContext(),
+                                           CL_MEM_READ_ONLY, targets.size());
+            set.targetsCapacity = targets.size();
+        }
+        /* blocking, as the host copy may change before the next run: */
+        uploadQueue.enqueueWriteBuffer(set.targetsBuffer, true,
+                                       0, targets.size(), targets.data());
+        set.targetsVersion = targetsVersion;
+    }
+
+    static const cl_uint ZERO = 0;
+    uploadQueue.enqueueWriteBuffer(set.matchesBuffer, false,
+                                   0, sizeof(cl_uint), &ZERO);
+    uploadQueue.enqueueWriteBuffer(set.jobTargetsBuffer, false,
+                                   0, batchSize * sizeof(cl_uint),
+                                   set.jobTargets.data());
 }
 
-void KernelRunner::copyOutputBlocks()
+void KernelRunner::copyOutputBlocks(BufferSet &set)
 {
+    std::vector<cl::Event> waitList { set.kernelEnd };
+    if (zeroCopy) {
+        /* the host reads the output in the device buffers themselves: */
+        mapBuffers(set, &waitList, set.compared ? nullptr : &set.end);
+        if (!set.compared) {
+            return;
+        }
+        /* the download queue is in-order, so the maps are done first: */
+        waitList.clear();
+    }
+    if (set.compared) {
+        /* only the match counter, the matches are read on demand: */
+        downloadQueue.enqueueReadBuffer(set.matchesBuffer, false,
+                                        0, sizeof(cl_uint), &set.matchCount,
+                                        waitList.empty() ? nullptr : &waitList,
+                                        &set.end);
+        return;
+    }
+    if (deviceInitFinalize) {
+        downloadQueue.enqueueReadBuffer(set.tagsBuffer, false,
+                                        0, batchSize * getOutputSize(),
+                                        set.blocksOut, &waitList, &set.end);
+        return;
+    }
+
     std::size_t jobSize = params->getMemorySize();
     std::size_t copySize = params->getLanes() * ARGON2_BLOCK_SIZE;
 
-    queue.enqueueReadBufferRect(memoryBuffer, false,
-                                makeSize3(jobSize - copySize, 0, 0),
-                                makeSize3(0, 0, 0),
-                                makeSize3(copySize, batchSize, 1),
-                                jobSize, 0, copySize, 0, blocksOut.get());
+    for (std::size_t i = 0; i < set.memoryBuffers.size(); i++) {
+        downloadQueue.enqueueReadBufferRect(
+                    set.memoryBuffers[i], false,
+                    makeSize3(jobSize - copySize, 0, 0),
+                    makeSize3(0, getFirstJob(i), 0),
+                    makeSize3(copySize, getJobCount(i), 1),
+                    jobSize, 0, copySize, 0,
+                    set.blocksOut, i == 0 ? &waitList : nullptr, &set.end);
+    }
 }
 
-void KernelRunner::run(std::uint32_t lanesPerBlock, std::size_t jobsPerBlock)
+void KernelRunner::run(std::size_t buffer,
+                       std::uint32_t lanesPerBlock, std::size_t jobsPerBlock)
 {
     std::uint32_t lanes = params->getLanes();
     std::uint32_t passes = params->getTimeCost();
 
+    if (buffer >= buffers.size()) {
+        throw std::logic_error("Invalid buffer!");
+    }
+
     if (bySegment) {
         if (lanesPerBlock > lanes || lanes % lanesPerBlock != 0) {
             throw std::logic_error("Invalid lanesPerBlock!");
@@ -167,56 +499,141 @@ void KernelRunner::run(std::uint32_t lanesPerBlock, std::size_t jobsPerBlock)
         }
     }
 
-    if (jobsPerBlock > batchSize || batchSize % jobsPerBlock != 0) {
+    if (jobsPerBlock > jobsPerMemoryBuffer
+            || jobsPerMemoryBuffer % jobsPerBlock != 0
+            || batchSize % jobsPerBlock != 0) {
         throw std::logic_error("Invalid jobsPerBlock!");
     }
 
-    cl::NDRange globalRange { THREADS_PER_LANE * lanes, batchSize };
+    BufferSet &set = buffers[buffer];
+
     cl::NDRange localRange { THREADS_PER_LANE * lanesPerBlock, jobsPerBlock };
 
-    queue.enqueueMarker(&start);
+    uploadQueue.enqueueMarker(&set.start);
 
-    copyInputBlocks();
+    /* The upload queue is in-order, so these are done by the time
+     * set.kernelStart is signalled: */
+    set.compared = targetCount != 0;
+    if (set.compared) {
+        copyTargets(set);
+    }
 
-    queue.enqueueMarker(&kernelStart);
+    /* signals set.kernelStart when done: */
+    copyInputBlocks(set);
 
     std::size_t shmemSize = THREADS_PER_LANE * lanesPerBlock * jobsPerBlock
             * sizeof(cl_uint) * 2;
     kernel.setArg<cl::LocalSpaceArg>(0, { shmemSize });
+
+    /* The kernel queue is in-order, so only the first kernel has to wait
+     * for the upload. The kernels that touch the job memory run once per
+     * memory buffer, with its first job as the global offset: */
+    std::vector<cl::Event> waitList { set.kernelStart };
+    auto enqueue = [&](const cl::Kernel &launched, const cl::NDRange &offset,
+                       const cl::NDRange &global, const cl::NDRange &local) {
+        queue.enqueueNDRangeKernel(launched, offset, global, local,
+                                   waitList.empty() ? nullptr : &waitList,
+                                   &set.kernelEnd);
+        waitList.clear();
+    };
+    std::size_t memoryBufferCount = set.memoryBuffers.size();
+
+    if (deviceInitFinalize) {
+        initKernel.setArg<cl::Buffer>(0, set.seedsBuffer);
+        for (std::size_t i = 0; i < memoryBufferCount; i++) {
+            initKernel.setArg<cl::Buffer>(1, set.memoryBuffers[i]);
+            enqueue(initKernel, cl::NDRange(0, getFirstJob(i)),
+                    cl::NDRange(2 * lanes, getJobCount(i)), cl::NullRange);
+        }
+    }
+
     if (bySegment) {
         for (std::uint32_t pass = 0; pass < passes; pass++) {
             for (std::uint32_t slice = 0; slice < ARGON2_SYNC_POINTS; slice++) {
                 kernel.setArg<cl_uint>(precompute ? 6 : 5, pass);
                 kernel.setArg<cl_uint>(precompute ? 7 : 6, slice);
-                queue.enqueueNDRangeKernel(kernel, cl::NullRange,
-                                           globalRange, localRange);
+                for (std::size_t i = 0; i < memoryBufferCount; i++) {
+                    kernel.setArg<cl::Buffer>(1, set.memoryBuffers[i]);
+                    enqueue(kernel, cl::NDRange(0, getFirstJob(i)),
+                            cl::NDRange(THREADS_PER_LANE * lanes,
+                                        getJobCount(i)),
+                            localRange);
+                }
             }
         }
     } else {
-        queue.enqueueNDRangeKernel(kernel, cl::NullRange,
-                                   globalRange, localRange);
+        for (std::size_t i = 0; i < memoryBufferCount; i++) {
+            kernel.setArg<cl::Buffer>(1, set.memoryBuffers[i]);
+            enqueue(kernel, cl::NDRange(0, getFirstJob(i)),
+                    cl::NDRange(THREADS_PER_LANE * lanes, getJobCount(i)),
+                    localRange);
+        }
+    }
+
+    if (deviceInitFinalize) {
+        finalizeKernel.setArg<cl::Buffer>(1, set.tagsBuffer);
+        for (std::size_t i = 0; i < memoryBufferCount; i++) {
+            finalizeKernel.setArg<cl::Buffer>(0, set.memoryBuffers[i]);
+            enqueue(finalizeKernel, cl::NDRange(getFirstJob(i)),
+                    cl::NDRange(getJobCount(i)), cl::NullRange);
+        }
+    }
+
+    if (set.compared) {
+        compareKernel.setArg<cl::Buffer>(0, set.tagsBuffer);
+        compareKernel.setArg<cl::Buffer>(1, set.targetsBuffer);
+        compareKernel.setArg<cl_uint>(2, targetCount);
+        compareKernel.setArg<cl::Buffer>(3, set.jobTargetsBuffer);
+        compareKernel.setArg<cl::Buffer>(4, set.matchesBuffer);
+        enqueue(compareKernel, cl::NullRange, cl::NDRange(batchSize),
+                cl::NullRange);
     }
 
-    queue.enqueueMarker(&kernelEnd);
+    /* signals set.end when done: */
+    copyOutputBlocks(set);
 
-    copyOutputBlocks();
+    uploadQueue.flush();
+    queue.flush();
+    downloadQueue.flush();
+}
 
-    queue.enqueueMarker(&end);
+void KernelRunner::waitForInput(std::size_t buffer)
+{
+    BufferSet &set = buffers.at(buffer);
+    if (zeroCopy) {
+        /* the input lives in the job memory, which is only mapped again
+         * once the run is over: */
+        set.end.wait();
+        return;
+    }
+    set.kernelStart.wait();
 }
 
-float KernelRunner::finish()
+float KernelRunner::finish(std::size_t buffer)
 {
-    end.wait();
+    BufferSet &set = buffers.at(buffer);
+    set.end.wait();
 
 #ifndef NDEBUG
     std::cerr << "[INFO] Copy to device took "
-              << getDurationInMs(start, kernelStart) << " ms." << std::endl;
+              << getDurationInMs(set.start, set.kernelStart) << " ms." << std::endl;
 
     std::cerr << "[INFO] Copy from device took "
-              << getDurationInMs(kernelEnd, end) << " ms." << std::endl;
+              << getDurationInMs(set.kernelEnd, set.end) << " ms." << std::endl;
 #endif
 
-    return getDurationInMs(start, end);
+    return getDurationInMs(set.start, set.end);
+}
+
+void KernelRunner::readMatches(std::size_t buffer, cl_uint *pairs)
+{
+    BufferSet &set = buffers.at(buffer);
+    if (set.matchCount != 0) {
+        downloadQueue.enqueueReadBuffer(set.matchesBuffer, true,
+                                        sizeof(cl_uint),
+                                        2 * set.matchCount * sizeof(cl_uint),
+                                        pairs);
+    }
 }
 
 } // namespace opencl
@@ -1,6 +1,14 @@
 #include "processingunit.h"
 
+#include "argon2-gpu-common/hostbatch.h"
+#include "argon2-gpu-common/tuningcache.h"
+
+#include <algorithm>
+#include <cstring>
 #include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #ifndef NDEBUG
 #include <iostream>
 #endif
@@ -13,19 +21,74 @@ static bool isPowerOfTwo(std::size_t x)
     return (x & (x - 1)) == 0;
 }
 
+/* A cached result is only trusted if the runner accepts it: */
+static bool isValidTuning(const KernelRunner &runner, std::uint32_t lanes,
+                          const TuningResult &tuning)
+{
+    return tuning.lanesPerBlock >= runner.getMinLanesPerBlock()
+            && tuning.lanesPerBlock <= runner.getMaxLanesPerBlock()
+            && lanes % tuning.lanesPerBlock == 0
+            && tuning.jobsPerBlock >= runner.getMinJobsPerBlock()
+            && tuning.jobsPerBlock <= runner.getMaxJobsPerBlock()
+            && runner.getBatchSize() % tuning.jobsPerBlock == 0
+            && runner.getJobsPerMemoryBuffer() % tuning.jobsPerBlock == 0;
+}
+
+static void checkJobParams(const Argon2Params &unitParams,
+                           const Argon2Params &jobParams,
+                           bool deviceInitFinalize)
+{
+    if (jobParams.getTimeCost() != unitParams.getTimeCost()
+            || jobParams.getMemoryCost() != unitParams.getMemoryCost()
+            || jobParams.getLanes() != unitParams.getLanes()) {
+        throw std::logic_error("Job params do not match unit params!");
+    }
+    /* the finalization kernel produces tags of the unit's length: */
+    if (deviceInitFinalize
+            && jobParams.getOutputLength() != unitParams.getOutputLength()) {
+        throw std::logic_error("Job params do not match unit params!");
+    }
+}
+
 ProcessingUnit::ProcessingUnit(
         const ProgramContext *programContext, const Argon2Params *params,
         const Device *device, std::size_t batchSize,
-        bool bySegment, bool precomputeRefs)
+        bool bySegment, bool precomputeRefs, std::size_t bufferCount,
+        bool deviceInitFinalize)
     : programContext(programContext), params(params), device(device),
       runner(programContext, params, device, batchSize, bySegment,
-             precomputeRefs),
+             precomputeRefs, bufferCount, deviceInitFinalize),
       bestLanesPerBlock(runner.getMinLanesPerBlock()),
-      bestJobsPerBlock(runner.getMinJobsPerBlock())
+      bestJobsPerBlock(runner.getMinJobsPerBlock()),
+      inputBuffer(0), outputBuffer(0), pendingBuffers()
 {
     /* pre-fill first blocks with pseudo-random data: */
-    for (std::size_t i = 0; i < batchSize; i++) {
-        setPassword(i, NULL, 0);
+    std::vector<const void *> pws(batchSize, nullptr);
+    std::vector<std::size_t> pwSizes(batchSize, 0);
+    for (std::size_t buffer = 0; buffer < bufferCount; buffer++) {
+        fillInputs(buffer, 0, batchSize, pws.data(), pwSizes.data(), nullptr);
+    }
+
+    std::string mode = std::string(bySegment ? "by-segment" : "oneshot")
+            + (precomputeRefs ? ",precompute" : ",in-place")
+            + (deviceInitFinalize ? ",device-init-finalize" : "")
+            + (programContext->isSpecialized() ? ",specialized" : "");
+    std::string tuningKey = TuningCache::makeKey(
+                "opencl", device->getName(), *params,
+                programContext->getArgon2Type(),
+                programContext->getArgon2Version(), batchSize, mode);
+
+    TuningResult tuning;
+    if (TuningCache::instance().lookup(tuningKey, tuning)
+            && isValidTuning(runner, params->getLanes(), tuning)) {
+        bestLanesPerBlock = tuning.lanesPerBlock;
+        bestJobsPerBlock = tuning.jobsPerBlock;
+#ifndef NDEBUG
+        std::cerr << "[INFO] Using cached tuning: " << bestLanesPerBlock
+                  << " lanes per block, " << bestJobsPerBlock
+                  << " jobs per block." << std::endl;
+#endif
+        return;
     }
 
     if (runner.getMaxLanesPerBlock() > runner.getMinLanesPerBlock()
@@ -75,8 +138,10 @@ ProcessingUnit::ProcessingUnit(
 #endif
 
         float bestTime = std::numeric_limits<float>::infinity();
-        for (std::size_t jpb = 1; jpb <= runner.getMaxJobsPerBlock();
-             jpb *= 2)
+        /* with several memory buffers, the batch size need not be a
+         * multiple of every power of two up to the maximum: */
+        for (std::size_t jpb = 1; jpb <= runner.getMaxJobsPerBlock()
+             && runner.getBatchSize() % jpb == 0; jpb *= 2)
         {
             float time;
             try {
@@ -105,31 +170,185 @@ ProcessingUnit::ProcessingUnit(
                   << " jobs per block." << std::endl;
 #endif
     }
+
+    TuningCache::instance().store(
+                tuningKey, TuningResult { bestLanesPerBlock, bestJobsPerBlock });
+}
+
+void ProcessingUnit::fillInput(void *memory, const Argon2Params &jobParams,
+                               const void *pw, std::size_t pwSize) const
+{
+    if (runner.isDeviceInitFinalize()) {
+        jobParams.initialHash(memory, pw, pwSize,
+                              programContext->getArgon2Type(),
+                              programContext->getArgon2Version());
+    } else {
+        jobParams.fillFirstBlocks(memory, pw, pwSize,
+                                  programContext->getArgon2Type(),
+                                  programContext->getArgon2Version());
+    }
+}
+
+void ProcessingUnit::fillInputs(std::size_t buffer, std::size_t begin,
+                                std::size_t end, const void *const *pws,
+                                const std::size_t *pwSizes,
+                                const Argon2Params *const *jobParams) const
+{
+    if (begin > end || end > runner.getBatchSize()) {
+        throw std::logic_error("Invalid job range!");
+    }
+
+    std::vector<void *> memories(end - begin);
+    for (std::size_t i = 0; i < end - begin; i++) {
+        if (jobParams != nullptr) {
+            checkJobParams(*params, *jobParams[i],
+                           runner.isDeviceInitFinalize());
+        }
+        memories[i] = runner.getInputMemory(buffer, begin + i);
+    }
+
+    argon2::fillInputs(*params, jobParams, memories.data(), pws, pwSizes,
+                       end - begin, programContext->getArgon2Type(),
+                       programContext->getArgon2Version(),
+                       runner.isDeviceInitFinalize());
+}
+
+void ProcessingUnit::readOutput(void *hash, const Argon2Params &jobParams,
+                                const void *memory) const
+{
+    if (runner.isDeviceInitFinalize()) {
+        std::memcpy(hash, memory, jobParams.getOutputLength());
+    } else {
+        jobParams.finalize(hash, memory);
+    }
 }
 
 void ProcessingUnit::setPassword(std::size_t index, const void *pw,
                                  std::size_t pwSize)
 {
-    void *memory = runner.getInputMemory(index);
-    params->fillFirstBlocks(memory, pw, pwSize,
-                            programContext->getArgon2Type(),
-                            programContext->getArgon2Version());
+    fillInput(runner.getInputMemory(inputBuffer, index), *params, pw, pwSize);
 }
 
 void ProcessingUnit::getHash(std::size_t index, void *hash)
 {
-    const void *memory = runner.getOutputMemory(index);
-    params->finalize(hash, memory);
+    if (runner.isCompared(outputBuffer)) {
+        throw std::logic_error("Tags were compared on the device!");
+    }
+    readOutput(hash, *params, runner.getOutputMemory(outputBuffer, index));
+}
+
+void ProcessingUnit::setPassword(std::size_t index,
+                                 const Argon2Params &jobParams,
+                                 const void *pw, std::size_t pwSize)
+{
+    checkJobParams(*params, jobParams, runner.isDeviceInitFinalize());
+
+    fillInput(runner.getInputMemory(inputBuffer, index), jobParams, pw, pwSize);
+}
+
+void ProcessingUnit::getHash(std::size_t index, const Argon2Params &jobParams,
+                             void *hash)
+{
+    checkJobParams(*params, jobParams, runner.isDeviceInitFinalize());
+    if (runner.isCompared(outputBuffer)) {
+        throw std::logic_error("Tags were compared on the device!");
+    }
+
+    readOutput(hash, jobParams, runner.getOutputMemory(outputBuffer, index));
+}
+
+void ProcessingUnit::setPasswords(std::size_t begin, std::size_t end,
+                                  const void *const *pws,
+                                  const std::size_t *pwSizes,
+                                  const Argon2Params *const *jobParams)
+{
+    fillInputs(inputBuffer, begin, end, pws, pwSizes, jobParams);
+}
+
+void ProcessingUnit::getHashes(std::size_t begin, std::size_t end,
+                               void *const *hashes,
+                               const Argon2Params *const *jobParams)
+{
+    if (begin > end || end > runner.getBatchSize()) {
+        throw std::logic_error("Invalid job range!");
+    }
+    if (runner.isCompared(outputBuffer)) {
+        throw std::logic_error("Tags were compared on the device!");
+    }
+
+    std::vector<const void *> memories(end - begin);
+    for (std::size_t i = 0; i < end - begin; i++) {
+        if (jobParams != nullptr) {
+            checkJobParams(*params, *jobParams[i],
+                           runner.isDeviceInitFinalize());
+        }
+        memories[i] = runner.getOutputMemory(outputBuffer, begin + i);
+    }
+
+    readOutputs(*params, jobParams, hashes, memories.data(), end - begin,
+                runner.isDeviceInitFinalize());
+}
+
+void ProcessingUnit::setTargets(const void *tags, std::size_t count)
+{
+    runner.setTargets(tags, count);
+}
+
+void ProcessingUnit::setTarget(std::size_t index, std::uint32_t targetIndex)
+{
+    if (!runner.isDeviceInitFinalize()) {
+        throw std::logic_error("Device comparison requires deviceInitFinalize!");
+    }
+    runner.setJobTarget(inputBuffer, index, targetIndex);
+}
+
+std::vector<Match> ProcessingUnit::getMatches()
+{
+    if (!runner.isCompared(outputBuffer)) {
+        throw std::logic_error("Tags were not compared on the device!");
+    }
+
+    std::size_t count = runner.getMatchCount(outputBuffer);
+    std::vector<cl_uint> pairs(2 * count);
+    runner.readMatches(outputBuffer, pairs.data());
+
+    std::vector<Match> matches;
+    matches.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        matches.push_back(Match { pairs[2 * i], pairs[2 * i + 1] });
+    }
+    /* the device appends them in no particular order: */
+    std::sort(matches.begin(), matches.end(),
+              [](const Match &a, const Match &b) { return a.jobId < b.jobId; });
+    return matches;
 }
 
 void ProcessingUnit::beginProcessing()
 {
-    runner.run(bestLanesPerBlock, bestJobsPerBlock);
+    if (pendingBuffers.size() == runner.getBufferCount()) {
+        throw std::logic_error("All buffer sets are already being processed!");
+    }
+
+    runner.run(inputBuffer, bestLanesPerBlock, bestJobsPerBlock);
+    pendingBuffers.push_back(inputBuffer);
+
+    inputBuffer = (inputBuffer + 1) % runner.getBufferCount();
+    if (pendingBuffers.front() == inputBuffer) {
+        /* the next buffer set is still in flight (always the case with a
+         * single set) -- its input may only be overwritten once uploaded: */
+        runner.waitForInput(inputBuffer);
+    }
 }
 
 void ProcessingUnit::endProcessing()
 {
-    runner.finish();
+    if (pendingBuffers.empty()) {
+        throw std::logic_error("No batch is being processed!");
+    }
+
+    outputBuffer = pendingBuffers.front();
+    pendingBuffers.pop_front();
+    runner.finish(outputBuffer);
 }
 
 } // namespace opencl
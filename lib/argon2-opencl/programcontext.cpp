@@ -5,16 +5,24 @@
 namespace argon2 {
 namespace opencl {
 
+static std::vector<cl::Device> getCLDevices(const std::vector<Device> &devices)
+{
+    std::vector<cl::Device> clDevices;
+    clDevices.reserve(devices.size());
+    for (auto &device : devices) {
+        clDevices.push_back(device.getCLDevice());
+    }
+    return clDevices;
+}
+
 ProgramContext::ProgramContext(
         const GlobalContext *globalContext,
         const std::vector<Device> &devices,
         Type type, Version version)
-    : globalContext(globalContext), devices(), type(type), version(version)
+    : globalContext(globalContext), devices(getCLDevices(devices)),
+      type(type), version(version),
+      specialized(false), passes(0), lanes(0), segmentBlocks(0)
 {
-    this->devices.reserve(devices.size());
-    for (auto &device : devices) {
-        this->devices.push_back(device.getCLDevice());
-    }
     context = cl::Context(this->devices);
 
     program = KernelLoader::loadArgon2Program(
@@ -22,6 +30,23 @@ ProgramContext::ProgramContext(
                 context, "./data/kernels", type, version);
 }
 
+ProgramContext::ProgramContext(
+        const GlobalContext *globalContext,
+        const std::vector<Device> &devices,
+        Type type, Version version, const Argon2Params &params)
+    : globalContext(globalContext), devices(getCLDevices(devices)),
+      type(type), version(version),
+      specialized(true), passes(params.getTimeCost()),
+      lanes(params.getLanes()), segmentBlocks(params.getSegmentBlocks())
+{
+    context = cl::Context(this->devices);
+
+    program = KernelLoader::loadArgon2Program(
+                // FIXME path:
+                context, "./data/kernels",
+                KernelLoader::getDefaultCacheDirectory(),
+                type, version, params);
+}
+
 } // namespace opencl
 } // namespace argon2
-
@@ -1,11 +1,136 @@
 #include "benchmark.h"
 
+#include <cstdio>
 #include <iostream>
 
 Argon2Runner::~Argon2Runner() { }
 
 BenchmarkExecutive::~BenchmarkExecutive() { }
 
+static const char *getTypeName(argon2::Type type)
+{
+    switch (type) {
+    case argon2::ARGON2_I:
+        return "i";
+    case argon2::ARGON2_D:
+        return "d";
+    case argon2::ARGON2_ID:
+        return "id";
+    }
+    return "?";
+}
+
+static const char *getVersionName(argon2::Version version)
+{
+    return version == argon2::ARGON2_VERSION_10 ? "1.0" : "1.3";
+}
+
+static std::string jsonString(const std::string &value)
+{
+    std::string res = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            res += '\\';
+            res += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x",
+                          static_cast<unsigned>(c));
+            res += escaped;
+        } else {
+            res += c;
+        }
+    }
+    return res + "\"";
+}
+
+static std::string csvString(const std::string &value)
+{
+    std::string res = "\"";
+    for (char c : value) {
+        if (c == '"') {
+            res += '"';
+        }
+        res += c;
+    }
+    return res + "\"";
+}
+
+/* Prints the whole run as a single JSON object on one line (so that the
+ * output of several runs forms a JSON Lines file): */
+void BenchmarkDirector::printJson(const Argon2Runner &runner,
+                                  const RunTimeStats &stats) const
+{
+    auto &time = stats.getNanoseconds();
+
+    std::cout << "{\"mode\":" << jsonString(mode)
+              << ",\"device\":" << jsonString(runner.getDeviceName())
+              << ",\"type\":\"" << getTypeName(type) << "\""
+              << ",\"version\":\"" << getVersionName(version) << "\""
+              << ",\"t_cost\":" << t_cost
+              << ",\"m_cost\":" << m_cost
+              << ",\"lanes\":" << lanes
+              << ",\"batch_size\":" << batchSize
+              << ",\"kernel\":\"" << (bySegment ? "by-segment" : "oneshot") << "\""
+              << ",\"precompute_refs\":" << (precomputeRefs ? "true" : "false")
+              << ",\"lanes_per_block\":" << runner.getLanesPerBlock()
+              << ",\"jobs_per_block\":" << runner.getJobsPerBlock()
+              << ",\"samples_ns\":[";
+    bool first = true;
+    for (auto sample : time.getSamples()) {
+        std::cout << (first ? "" : ",") << sample;
+        first = false;
+    }
+    std::cout << "]"
+              << ",\"min_ns\":" << time.getMin()
+              << ",\"median_ns\":" << time.getMedian()
+              << ",\"p90_ns\":" << time.getPercentile(90)
+              << ",\"p99_ns\":" << time.getPercentile(99)
+              << ",\"max_ns\":" << time.getMax()
+              << ",\"mean_ns\":" << time.getMean()
+              << ",\"mdev_ns\":" << time.getMeanDeviation()
+              << ",\"mean_ns_per_hash\":" << stats.getNanosecsPerHash().getMean()
+              << ",\"hashes_per_second\":" << stats.getHashesPerSecond()
+              << "}" << std::endl;
+}
+
+/* Prints the run as one CSV row (after a header row, unless disabled);
+ * the per-sample times are separated by spaces within one field: */
+void BenchmarkDirector::printCsv(const Argon2Runner &runner,
+                                 const RunTimeStats &stats) const
+{
+    auto &time = stats.getNanoseconds();
+
+    if (outputHeader) {
+        std::cout << "mode,device,type,version,t_cost,m_cost,lanes,"
+                  << "batch_size,kernel,precompute_refs,lanes_per_block,"
+                  << "jobs_per_block,samples_ns,min_ns,median_ns,p90_ns,"
+                  << "p99_ns,max_ns,mean_ns,mdev_ns,mean_ns_per_hash,"
+                  << "hashes_per_second" << std::endl;
+    }
+
+    std::string samples;
+    for (auto sample : time.getSamples()) {
+        samples += (samples.empty() ? "" : " ") + std::to_string(sample);
+    }
+
+    std::cout << mode << "," << csvString(runner.getDeviceName())
+              << "," << getTypeName(type) << "," << getVersionName(version)
+              << "," << t_cost << "," << m_cost << "," << lanes
+              << "," << batchSize
+              << "," << (bySegment ? "by-segment" : "oneshot")
+              << "," << (precomputeRefs ? "yes" : "no")
+              << "," << runner.getLanesPerBlock()
+              << "," << runner.getJobsPerBlock()
+              << "," << samples
+              << "," << time.getMin() << "," << time.getMedian()
+              << "," << time.getPercentile(90) << "," << time.getPercentile(99)
+              << "," << time.getMax() << "," << time.getMean()
+              << "," << time.getMeanDeviation()
+              << "," << stats.getNanosecsPerHash().getMean()
+              << "," << stats.getHashesPerSecond() << std::endl;
+}
+
 int BenchmarkDirector::runBenchmark(Argon2Runner &runner) const
 {
     DummyPasswordGenerator pwGen;
@@ -35,6 +160,22 @@ int BenchmarkDirector::runBenchmark(Argon2Runner &runner) const
         std::cout << "Mean deviation (per hash): "
                   << RunTimeStats::repr(nanosecs(perHash.getMeanDeviation()))
                   << std::endl;
+        std::cout << "Median / 90th / 99th percentile: "
+                  << RunTimeStats::repr(time.getMedian()) << " / "
+                  << RunTimeStats::repr(time.getPercentile(90)) << " / "
+                  << RunTimeStats::repr(time.getPercentile(99))
+                  << std::endl;
+        std::cout << "Hashes per second: " << stats.getHashesPerSecond()
+                  << std::endl;
+        return 0;
+    }
+
+    if (outputMode == "json") {
+        printJson(runner, stats);
+        return 0;
+    }
+    if (outputMode == "csv") {
+        printCsv(runner, stats);
         return 0;
     }
 
@@ -14,22 +14,37 @@ public:
     virtual ~Argon2Runner();
     virtual nanosecs runBenchmark(const BenchmarkDirector &director,
                                   PasswordGenerator &pwGen) = 0;
+
+    virtual std::string getDeviceName() const = 0;
+
+    /* The launch configuration picked by the autotuning (0 if the runner
+     * has none): */
+    virtual std::uint32_t getLanesPerBlock() const { return 0; }
+    virtual std::size_t getJobsPerBlock() const { return 0; }
 };
 
 class BenchmarkDirector
 {
 private:
     std::string progname;
+    std::string mode;
     argon2::Type type;
     argon2::Version version;
     std::size_t t_cost, m_cost, lanes;
     std::size_t batchSize, samples;
     bool bySegment, precomputeRefs;
     std::string outputMode, outputType;
+    bool outputHeader;
     bool beVerbose;
 
+    void printJson(const Argon2Runner &runner,
+                   const RunTimeStats &stats) const;
+    void printCsv(const Argon2Runner &runner,
+                  const RunTimeStats &stats) const;
+
 public:
     const std::string &getProgname() const { return progname; }
+    const std::string &getMode() const { return mode; }
     argon2::Type getType() const { return type; }
     argon2::Version getVersion() const { return version; }
     std::size_t getTimeCost() const { return t_cost; }
@@ -40,18 +55,19 @@ public:
     bool isPrecomputeRefs() const { return precomputeRefs; }
     bool isVerbose() const { return beVerbose; }
 
-    BenchmarkDirector(const std::string &progname,
+    BenchmarkDirector(const std::string &progname, const std::string &mode,
                       argon2::Type type, argon2::Version version,
                       std::size_t t_cost, std::size_t m_cost, std::size_t lanes,
                       std::size_t batchSize, bool bySegment,
                       bool precomputeRefs, std::size_t samples,
                       const std::string &outputMode,
-                      const std::string &outputType)
-        : progname(progname), type(type), version(version),
+                      const std::string &outputType,
+                      bool outputHeader = true)
+        : progname(progname), mode(mode), type(type), version(version),
           t_cost(t_cost), m_cost(m_cost), lanes(lanes), batchSize(batchSize),
           samples(samples), bySegment(bySegment), precomputeRefs(precomputeRefs),
           outputMode(outputMode), outputType(outputType),
-          beVerbose(outputMode == "verbose")
+          outputHeader(outputHeader), beVerbose(outputMode == "verbose")
     {
     }
 
@@ -134,6 +134,12 @@ class CpuRunner : public Argon2Runner
 public:
     nanosecs runBenchmark(const BenchmarkDirector &director,
                           PasswordGenerator &pwGen) override;
+
+    std::string getDeviceName() const override
+    {
+        return "CPU (" + std::to_string(std::thread::hardware_concurrency())
+                + " threads)";
+    }
 };
 
 nanosecs CpuRunner::runBenchmark(const BenchmarkDirector &director,
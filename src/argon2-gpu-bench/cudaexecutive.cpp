@@ -11,6 +11,7 @@ class CudaRunner : public Argon2Runner
 private:
     argon2::Argon2Params params;
     argon2::cuda::ProcessingUnit unit;
+    std::string deviceName;
 
 public:
     CudaRunner(const BenchmarkDirector &director,
@@ -20,12 +21,23 @@ public:
                  director.getTimeCost(), director.getMemoryCost(),
                  director.getLanes()),
           unit(&pc, &params, &device, director.getBatchSize(),
-               director.isBySegment(), director.isPrecomputeRefs())
+               director.isBySegment(), director.isPrecomputeRefs()),
+          deviceName(device.getName())
     {
     }
 
     nanosecs runBenchmark(const BenchmarkDirector &director,
                           PasswordGenerator &pwGen) override;
+
+    std::string getDeviceName() const override { return deviceName; }
+    std::uint32_t getLanesPerBlock() const override
+    {
+        return unit.getBestLanesPerBlock();
+    }
+    std::size_t getJobsPerBlock() const override
+    {
+        return unit.getBestJobsPerBlock();
+    }
 };
 
 nanosecs CudaRunner::runBenchmark(const BenchmarkDirector &director,
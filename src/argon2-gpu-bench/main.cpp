@@ -18,6 +18,7 @@ struct Arguments
 
     std::string outputType = "ns";
     std::string outputMode = "verbose";
+    bool outputHeader = true;
 
     std::string type = "i";
     std::string version = "1.3";
@@ -57,7 +58,10 @@ static CommandLineParser<Arguments> buildCmdLineParser()
             "output-type", 'o', "what to output (ns|ns-per-hash)", "ns", "TYPE"),
         new ArgumentOption<Arguments>(
             [] (Arguments &state, const std::string &mode) { state.outputMode = mode; },
-            "output-mode", '\0', "output mode (verbose|raw|mean|mean-and-mdev)", "verbose", "MODE"),
+            "output-mode", '\0', "output mode (verbose|raw|mean|mean-and-mdev|json|csv)", "verbose", "MODE"),
+        new FlagOption<Arguments>(
+            [] (Arguments &state) { state.outputHeader = false; },
+            "no-header", '\0', "omit the header row in the csv output mode"),
 
         new ArgumentOption<Arguments>(
             [] (Arguments &state, const std::string &type) { state.type = type; },
@@ -148,10 +152,10 @@ int main(int, const char * const *argv)
         return 1;
     }
 
-    BenchmarkDirector director(argv[0], type, version,
+    BenchmarkDirector director(argv[0], args.mode, type, version,
             args.t_cost, args.m_cost, args.lanes, args.batchSize,
             bySegment, args.precomputeRefs, args.sampleCount,
-            args.outputMode, args.outputType);
+            args.outputMode, args.outputType, args.outputHeader);
     if (args.mode == "opencl") {
         OpenCLExecutive exec(args.deviceIndex, args.listDevices);
         return exec.runBenchmark(director);
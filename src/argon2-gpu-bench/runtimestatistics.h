@@ -6,6 +6,7 @@
 #include <vector>
 #include <chrono>
 #include <numeric>
+#include <algorithm>
 
 typedef uintmax_t nanosecs;
 
@@ -19,6 +20,7 @@ class DataSet
 {
 private:
     std::vector<uintmax_t> samples;
+    std::vector<uintmax_t> sorted;
     uintmax_t sum;
     uintmax_t mean;
     uintmax_t devSum;
@@ -31,8 +33,20 @@ public:
 
     double getMeanDeviationPerMean() const { return (double)devMean / mean; }
 
+    uintmax_t getMin() const { return sorted.front(); }
+    uintmax_t getMax() const { return sorted.back(); }
+    uintmax_t getMedian() const { return getPercentile(50); }
+
+    /* The smallest sample that is not exceeded by percent % of the samples
+     * (nearest-rank method): */
+    uintmax_t getPercentile(unsigned percent) const
+    {
+        std::size_t rank = (percent * sorted.size() + 99) / 100;
+        return sorted[rank == 0 ? 0 : rank - 1];
+    }
+
     DataSet()
-        : samples(), sum(0), mean(0),
+        : samples(), sorted(), sum(0), mean(0),
           devSum(0), devMean(0)
     {
     }
@@ -55,6 +69,9 @@ public:
             return s + (dev >= 0 ? dev : -dev);
         });
         devMean = devSum / samples.size();
+
+        sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
     }
 };
 
@@ -68,6 +85,13 @@ private:
 public:
     const DataSet &getNanoseconds() const { return ns; }
     const DataSet &getNanosecsPerHash() const { return nsPerHash; }
+    std::uintmax_t getBatchSize() const { return batchSize; }
+
+    /* Hashes computed per second, on average: */
+    double getHashesPerSecond() const
+    {
+        return (double)batchSize / toSeconds(ns.getMean());
+    }
 
     RunTimeStats(std::size_t batchSize)
         : batchSize(batchSize), ns(), nsPerHash()
@@ -2,9 +2,11 @@
 #include "commandline/argumenthandlers.h"
 
 #include "argon2-gpu-common/argon2params.h"
+#include "argon2-gpu-common/tuningcache.h"
 #include "argon2-opencl/processingunit.h"
 #include "argon2-cuda/processingunit.h"
 #include "argon2-cuda/cudaexception.h"
+#include "argon2-cpu/processingunit.h"
 
 #include "argon2.h"
 
@@ -16,11 +18,54 @@
 #include <array>
 #include <cstdint>
 #include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
 
 using namespace argon2;
 
 constexpr std::size_t BATCH_SIZE = 8;
 
+/* Computes the tags of "password<first>" ... "password<first + count - 1>"
+ * with the reference implementation: */
+static void computeReference(Type type, Version version,
+                             const Argon2Params *params, std::size_t first,
+                             std::size_t count, std::uint8_t *out)
+{
+    auto outLen = params->getOutputLength();
+    for (std::size_t i = 0; i < count; i++) {
+        argon2_context ctx;
+        std::string input = "password" + std::to_string(first + i);
+
+        ctx.out = out + i * outLen;
+        ctx.outlen = outLen;
+        ctx.pwd = (uint8_t *)input.data();
+        ctx.pwdlen = input.size();
+
+        ctx.salt = (uint8_t *)params->getSalt();
+        ctx.saltlen = params->getSaltLength();
+        ctx.secret = (uint8_t *)params->getSecret();
+        ctx.secretlen = params->getSecretLength();
+        ctx.ad = (uint8_t *)params->getAssocData();
+        ctx.adlen = params->getAssocDataLength();
+
+        ctx.t_cost = params->getTimeCost();
+        ctx.m_cost = params->getMemoryCost();
+        ctx.threads = ctx.lanes = params->getLanes();
+
+        ctx.version = version;
+
+        ctx.allocate_cbk = NULL;
+        ctx.free_cbk = NULL;
+        ctx.flags = 0;
+
+        int err = argon2_ctx(&ctx, (argon2_type)type);
+        if (err) {
+            throw std::runtime_error(argon2_error_message(err));
+        }
+    }
+}
+
 template<class Device, class GlobalContext, class ProgramContext,
          class ProcessingUnit>
 std::size_t runParamsVsRef(const GlobalContext &global, const Device &device,
@@ -64,40 +109,11 @@ std::size_t runParamsVsRef(const GlobalContext &global, const Device &device,
                 auto bufferRef = std::unique_ptr<std::uint8_t[]>(
                             new std::uint8_t[BATCH_SIZE * outLen]);
 
-                for (std::size_t i = 0; i < BATCH_SIZE; i++) {
-                    argon2_context ctx;
-                    std::string input = "password" + std::to_string(i);
-
-                    ctx.out = bufferRef.get() + i * outLen;
-                    ctx.outlen = outLen;
-                    ctx.pwd = (uint8_t *)input.data();
-                    ctx.pwdlen = input.size();
-
-                    ctx.salt = (uint8_t *)params->getSalt();
-                    ctx.saltlen = params->getSaltLength();
-                    ctx.secret = (uint8_t *)params->getSecret();
-                    ctx.secretlen = params->getSecretLength();
-                    ctx.ad = (uint8_t *)params->getAssocData();
-                    ctx.adlen = params->getAssocDataLength();
-
-                    ctx.t_cost = params->getTimeCost();
-                    ctx.m_cost = params->getMemoryCost();
-                    ctx.threads = ctx.lanes = params->getLanes();
-
-                    ctx.version = version;
-
-                    ctx.allocate_cbk = NULL;
-                    ctx.free_cbk = NULL;
-                    ctx.flags = 0;
-
-                    int err = argon2_ctx(&ctx, (argon2_type)type);
-                    if (err) {
-                        throw std::runtime_error(argon2_error_message(err));
-                    }
-                }
+                computeReference(type, version, params, 0, BATCH_SIZE,
+                                 bufferRef.get());
 
                 auto buffer = std::unique_ptr<std::uint8_t[]>(
-                            new std::uint8_t[outLen]);
+                            new std::uint8_t[BATCH_SIZE * outLen]);
                 ProcessingUnit pu(&progCtx, params, &device, BATCH_SIZE,
                                   bySegment, precompute);
                 for (std::size_t i = 0; i < BATCH_SIZE; i++) {
@@ -110,11 +126,29 @@ std::size_t runParamsVsRef(const GlobalContext &global, const Device &device,
                 bool res = true;
                 for (std::size_t i = 0; i < BATCH_SIZE; i++) {
                     pu.getHash(i, buffer.get());
-
                     res = res && std::memcmp(bufferRef.get() + i * outLen,
                                              buffer.get(), outLen) == 0;
                 }
 
+                /* second pass: the same batch through the batch APIs: */
+                std::vector<std::string> inputs(BATCH_SIZE);
+                std::vector<const void *> pws(BATCH_SIZE);
+                std::vector<std::size_t> pwSizes(BATCH_SIZE);
+                std::vector<void *> hashes(BATCH_SIZE);
+                for (std::size_t i = 0; i < BATCH_SIZE; i++) {
+                    inputs[i] = "password" + std::to_string(i);
+                    pws[i] = inputs[i].data();
+                    pwSizes[i] = inputs[i].size();
+                    hashes[i] = buffer.get() + i * outLen;
+                }
+                pu.setPasswords(0, BATCH_SIZE, pws.data(), pwSizes.data());
+                pu.beginProcessing();
+                pu.endProcessing();
+                pu.getHashes(0, BATCH_SIZE, hashes.data());
+
+                res = res && std::memcmp(bufferRef.get(), buffer.get(),
+                                         BATCH_SIZE * outLen) == 0;
+
                 if (!res) {
                     ++failures;
                     std::cout << "FAIL" << std::endl;
@@ -194,6 +228,221 @@ std::size_t runTestCases(const GlobalContext &global, const Device &device,
     return failures;
 }
 
+/* The pipelined mode (several buffer sets in flight) is only tested where
+ * it exists: */
+template<class GlobalContext, class Device>
+std::size_t runPipelinedTests(const GlobalContext &, const Device &)
+{
+    return 0;
+}
+
+/* Runs more batches than buffer sets through a pipelined OpenCL
+ * ProcessingUnit, so every set is reused while others are in flight, and
+ * checks all the tags against the reference: */
+std::size_t runPipelinedTests(const opencl::GlobalContext &global,
+                              const opencl::Device &device)
+{
+    std::cout << "Running OpenCL pipelined mode tests..." << std::endl;
+
+    const std::size_t bufferCount = 2;
+    const std::size_t batches = 2 * bufferCount + 1;
+
+    std::size_t failures = 0;
+    for (auto type : { ARGON2_I, ARGON2_D, ARGON2_ID }) {
+        for (auto version : { argon2::ARGON2_VERSION_10, argon2::ARGON2_VERSION_13 }) {
+            opencl::ProgramContext progCtx(&global, { device }, type, version);
+            for (auto bySegment : {true, false}) {
+                for (auto onDevice : {false, true}) {
+                    for (auto params = std::begin(TEST_PARAMS);
+                         params < std::end(TEST_PARAMS); ++params) {
+                        std::cout << "  [pipelined]  "
+                                  << (bySegment ? "[by-segment] " : "[oneshot]    ")
+                                  << (onDevice ? "[on-device]  " : "")
+                                  << "type=" << type
+                                  << " v" << (version == argon2::ARGON2_VERSION_10 ? "1.0" : "1.3")
+                                  << " o=" << params->getOutputLength()
+                                  << " t=" << params->getTimeCost()
+                                  << " m=" << params->getMemoryCost()
+                                  << " p=" << params->getLanes();
+                        std::cout << "... ";
+
+                        auto outLen = params->getOutputLength();
+                        auto bufferRef = std::unique_ptr<std::uint8_t[]>(
+                                    new std::uint8_t[batches * BATCH_SIZE * outLen]);
+                        computeReference(type, version, params, 0,
+                                         batches * BATCH_SIZE, bufferRef.get());
+
+                        auto buffer = std::unique_ptr<std::uint8_t[]>(
+                                    new std::uint8_t[outLen]);
+                        opencl::ProcessingUnit pu(&progCtx, params, &device,
+                                                  BATCH_SIZE, bySegment, false,
+                                                  bufferCount, onDevice);
+
+                        /* keep bufferCount batches in flight, reading back the
+                         * oldest one before launching the next: */
+                        bool res = true;
+                        std::size_t done = 0;
+                        for (std::size_t batch = 0; batch < batches; batch++) {
+                            if (batch >= bufferCount) {
+                                pu.endProcessing();
+                                for (std::size_t i = 0; i < BATCH_SIZE; i++) {
+                                    pu.getHash(i, buffer.get());
+                                    res = res && std::memcmp(
+                                                bufferRef.get() + (done * BATCH_SIZE + i) * outLen,
+                                                buffer.get(), outLen) == 0;
+                                }
+                                done++;
+                            }
+                            for (std::size_t i = 0; i < BATCH_SIZE; i++) {
+                                std::string input = "password"
+                                        + std::to_string(batch * BATCH_SIZE + i);
+                                pu.setPassword(i, input.data(), input.size());
+                            }
+                            pu.beginProcessing();
+                        }
+                        for (; done < batches; done++) {
+                            pu.endProcessing();
+                            for (std::size_t i = 0; i < BATCH_SIZE; i++) {
+                                pu.getHash(i, buffer.get());
+                                res = res && std::memcmp(
+                                            bufferRef.get() + (done * BATCH_SIZE + i) * outLen,
+                                            buffer.get(), outLen) == 0;
+                            }
+                        }
+
+                        if (!res) {
+                            ++failures;
+                            std::cout << "FAIL" << std::endl;
+                        } else {
+                            std::cout << "PASS" << std::endl;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (!failures) {
+        std::cout << "  ALL PASSED" << std::endl;
+    }
+    return failures;
+}
+
+/* Backend-specific ProcessingUnit modes are only tested where they exist: */
+template<class GlobalContext, class Device>
+std::size_t runModeTests(const GlobalContext &, const Device &)
+{
+    return 0;
+}
+
+/* Checks the pipelined (two buffer sets), on-device init/finalize and
+ * on-device compare modes of the OpenCL ProcessingUnit, and a program
+ * specialized for the params, against its plain mode: */
+std::size_t runModeTests(const opencl::GlobalContext &global,
+                         const opencl::Device &device)
+{
+    std::cout << "Running OpenCL processing mode tests..." << std::endl;
+
+    std::size_t failures = 0;
+    for (auto type : { ARGON2_I, ARGON2_D, ARGON2_ID }) {
+        opencl::ProgramContext progCtx(&global, { device }, type,
+                                       argon2::ARGON2_VERSION_13);
+        for (auto params = std::begin(TEST_PARAMS);
+             params < std::end(TEST_PARAMS); ++params) {
+            std::cout << "  [pipelined]  [on-device]  [compare]  [specialized]  type=" << type
+                      << " o=" << params->getOutputLength()
+                      << " t=" << params->getTimeCost()
+                      << " m=" << params->getMemoryCost()
+                      << " p=" << params->getLanes();
+            std::cout << "... ";
+
+            auto outLen = params->getOutputLength();
+            auto bufferRef = std::unique_ptr<std::uint8_t[]>(
+                        new std::uint8_t[2 * BATCH_SIZE * outLen]);
+            auto buffer = std::unique_ptr<std::uint8_t[]>(
+                        new std::uint8_t[outLen]);
+
+            opencl::ProcessingUnit ref(&progCtx, params, &device, BATCH_SIZE);
+            for (std::size_t batch = 0; batch < 2; batch++) {
+                for (std::size_t i = 0; i < BATCH_SIZE; i++) {
+                    std::string input = "password" + std::to_string(batch * BATCH_SIZE + i);
+                    ref.setPassword(i, input.data(), input.size());
+                }
+                ref.beginProcessing();
+                ref.endProcessing();
+                for (std::size_t i = 0; i < BATCH_SIZE; i++) {
+                    ref.getHash(i, bufferRef.get() + (batch * BATCH_SIZE + i) * outLen);
+                }
+            }
+
+            opencl::ProcessingUnit pu(&progCtx, params, &device, BATCH_SIZE,
+                                      true, false, 2, true);
+            for (std::size_t batch = 0; batch < 2; batch++) {
+                for (std::size_t i = 0; i < BATCH_SIZE; i++) {
+                    std::string input = "password" + std::to_string(batch * BATCH_SIZE + i);
+                    pu.setPassword(i, input.data(), input.size());
+                }
+                pu.beginProcessing();
+            }
+
+            bool res = true;
+            for (std::size_t batch = 0; batch < 2; batch++) {
+                pu.endProcessing();
+                for (std::size_t i = 0; i < BATCH_SIZE; i++) {
+                    pu.getHash(i, buffer.get());
+
+                    res = res && std::memcmp(bufferRef.get() + (batch * BATCH_SIZE + i) * outLen,
+                                             buffer.get(), outLen) == 0;
+                }
+            }
+
+            /* compare the first batch against the tags of jobs 1 and 3: */
+            auto targets = std::unique_ptr<std::uint8_t[]>(
+                        new std::uint8_t[2 * outLen]);
+            std::memcpy(targets.get(), bufferRef.get() + 1 * outLen, outLen);
+            std::memcpy(targets.get() + outLen, bufferRef.get() + 3 * outLen, outLen);
+            pu.setTargets(targets.get(), 2);
+            for (std::size_t i = 0; i < BATCH_SIZE; i++) {
+                std::string input = "password" + std::to_string(i);
+                pu.setPassword(i, input.data(), input.size());
+            }
+            pu.beginProcessing();
+            pu.endProcessing();
+
+            auto matches = pu.getMatches();
+            res = res && matches.size() == 2
+                    && matches[0].jobId == 1 && matches[0].targetIndex == 0
+                    && matches[1].jobId == 3 && matches[1].targetIndex == 1;
+
+            opencl::ProgramContext specCtx(&global, { device }, type,
+                                           argon2::ARGON2_VERSION_13, *params);
+            opencl::ProcessingUnit spec(&specCtx, params, &device, BATCH_SIZE);
+            for (std::size_t i = 0; i < BATCH_SIZE; i++) {
+                std::string input = "password" + std::to_string(i);
+                spec.setPassword(i, input.data(), input.size());
+            }
+            spec.beginProcessing();
+            spec.endProcessing();
+            for (std::size_t i = 0; i < BATCH_SIZE; i++) {
+                spec.getHash(i, buffer.get());
+
+                res = res && std::memcmp(bufferRef.get() + i * outLen,
+                                         buffer.get(), outLen) == 0;
+            }
+
+            if (!res) {
+                ++failures;
+                std::cout << "FAIL" << std::endl;
+            } else {
+                std::cout << "PASS" << std::endl;
+            }
+        }
+    }
+    if (!failures) {
+        std::cout << "  ALL PASSED" << std::endl;
+    }
+    return failures;
+}
+
 template<class Device, class GlobalContext,
          class ProgramContext, class ProcessingUnit>
 int runAllTests(const char *progname, const char *name, std::size_t deviceIndex,
@@ -258,6 +507,9 @@ int runAllTests(const char *progname, const char *name, std::size_t deviceIndex,
     failures += runParamsVsRef<Device, GlobalContext, ProgramContext, ProcessingUnit>
             (global, device, ARGON2_ID, argon2::ARGON2_VERSION_13,
              std::begin(TEST_PARAMS), std::end(TEST_PARAMS));
+
+    failures += runPipelinedTests(global, device);
+    failures += runModeTests(global, device);
     return 0;
 }
 
@@ -285,7 +537,7 @@ static CommandLineParser<Arguments> buildCmdLineParser()
 
         new ArgumentOption<Arguments>(
             [] (Arguments &state, const std::string &mode) { state.mode = mode; },
-            "mode", 'm', "mode in which to run ('cuda' for CUDA or 'opencl' for OpenCL)", "cuda", "MODE"),
+            "mode", 'm', "mode in which to run ('cuda' for CUDA, 'opencl' for OpenCL or 'cpu' for CPU)", "cuda", "MODE"),
 
         new ArgumentOption<Arguments>(
             makeNumericHandler<Arguments, std::size_t>([] (Arguments &state, std::size_t index) {
@@ -298,7 +550,7 @@ static CommandLineParser<Arguments> buildCmdLineParser()
     };
 
     return CommandLineParser<Arguments>(
-        "A tool for testing the argon2-opencl and argon2-cuda libraries.",
+        "A tool for testing the argon2-opencl, argon2-cuda and argon2-cpu libraries.",
         positional, options);
 }
 
@@ -319,6 +571,9 @@ int main(int, const char * const *argv) {
     argon2_select_impl(nullptr, "[libargon2] ");
 #endif
 
+    /* exercise the autotuning every time and leave the user's cache be: */
+    TuningCache::instance().setPath({});
+
     std::size_t failures = 0;
     if (args.mode == "cuda") {
         try {
@@ -341,6 +596,11 @@ int main(int, const char * const *argv) {
                       << err.what() << std::endl;
             return 2;
         }
+    } else if (args.mode == "cpu") {
+        ret = runAllTests<cpu::Device, cpu::GlobalContext,
+                cpu::ProgramContext, cpu::ProcessingUnit>(
+                    argv[0], "CPU", args.deviceIndex, args.listDevices,
+                    failures);
     } else {
         std::cerr << argv[0] << ": invalid mode: " << args.mode << std::endl;
         return 2;
@@ -0,0 +1,18 @@
+#include <algorithm>
+
+#include "batch.hpp"
+
+
+// GetBatchSize returns how many jobs with the given parameters fit into
+// one batch of at most maxBatchMemory bytes of device memory
+std::size_t getBatchSize(const argon2::Argon2Params &params, std::size_t maxBatchMemory)
+{
+    std::size_t jobs = maxBatchMemory / params.getMemorySize();
+    return std::max(std::size_t(1), std::min(jobs, MaxBatchSize));
+}
+
+// GetCandidate returns the candidate of one job of the batch
+std::string getCandidate(const Batch &batch, const Job &job)
+{
+    return batch.source ? batch.source->getCandidate(job.index) : job.candidate;
+}
@@ -0,0 +1,51 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "candidate_source.hpp"
+#include "target.hpp"
+
+
+// Job is a single (hash, candidate) pair. The candidate is either stored in
+// the job or, in batches with a candidate source, given by its index.
+struct Job
+{
+    std::shared_ptr<Target> target;
+    std::string candidate;
+    std::uint64_t index;
+};
+
+// Batch is a set of jobs that share one ParamsKey and therefore run in one
+// kernel launch, even when their targets have different salts. A batch
+// made from the input files takes every line with its key between
+// firstLine and lastLine (1-based, inclusive) that was not skipped; in
+// mask mode the "lines" are the positions in the hashes x keyspace product.
+// With rules they are the positions in the lines x rules product, so the
+// candidates of one word may span several batches.
+struct Batch
+{
+    ParamsKey key;
+    std::vector<Job> jobs;
+    std::size_t firstLine;
+    std::size_t lastLine;
+    std::shared_ptr<const CandidateSource> source;
+};
+
+// Device memory taken by a single batch when the device limits are not
+// known. Argon2 memory is m * 1 KiB per job, so this caps the number of
+// jobs for large m.
+const std::size_t DefaultBatchMemory = std::size_t(256) * 1024 * 1024;
+const std::size_t MaxBatchSize = 4096;
+
+// GetCandidate returns the candidate of one job of the batch
+std::string getCandidate(const Batch &batch, const Job &job);
+
+// GetBatchSize returns how many jobs with the given parameters fit into
+// one batch of at most maxBatchMemory bytes of device memory
+std::size_t getBatchSize(const argon2::Argon2Params &params, std::size_t maxBatchMemory);
+
+#endif // BATCH_H
@@ -0,0 +1,311 @@
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "argon2-opencl/processingunit.h"
+
+#include "batch.hpp"
+#include "context_cache.hpp"
+
+
+// DeviceCompare tells whether a backend's ProcessingUnit can finalize the
+// hashes and compare them against the targets on the device, so that only
+// the matches are read back.
+template <class ProcessingUnit>
+struct DeviceCompare : std::false_type
+{
+};
+
+template <>
+struct DeviceCompare<argon2::opencl::ProcessingUnit> : std::true_type
+{
+};
+
+// SpecializedPrograms tells whether a backend can build programs with the
+// cost parameters of a hash compiled in.
+template <class ProcessingUnit>
+struct SpecializedPrograms : std::false_type
+{
+};
+
+template <>
+struct SpecializedPrograms<argon2::opencl::ProcessingUnit> : std::true_type
+{
+};
+
+// A specialized program takes about as long to build as the generic one,
+// which only pays off for parameter sets with plenty of candidates; smaller
+// batches (unless they already fill the device) share the generic program.
+const std::size_t MinSpecializedBatchSize = 64;
+
+// BatchRunner hashes batches on one device. It keeps its ProcessingUnit (and
+// thus the device buffers and the autotuning result) across batches as long
+// as they share the same ParamsKey and fit in the unit. A unit takes at most
+// maxBatchMemory bytes of device memory, the share of one worker.
+template <class Device, class GlobalContext, class ProgramContext, class ProcessingUnit>
+class BatchRunner
+{
+private:
+    std::size_t deviceIndex;
+    std::size_t maxBatchMemory;
+
+    // The unit keeps a pointer to its params, so hold on to their owner.
+    std::shared_ptr<Target> unitTarget;
+    std::unique_ptr<ProcessingUnit> unit;
+
+    typedef DeviceCompare<ProcessingUnit> Compare;
+    typedef SpecializedPrograms<ProcessingUnit> Specialize;
+
+    // The largest unit the device can hold with unitTarget's params (at
+    // most getBatchSize of them within maxBatchMemory).
+    std::size_t maxUnitSize = 0;
+
+    // The params of each job of the current launch.
+    std::vector<const argon2::Argon2Params *> jobParams;
+
+    // The indices of the jobs of the current launch.
+    std::vector<std::size_t> launchJobs;
+
+    // The generated candidates of the current launch, for batches with a
+    // candidate source.
+    std::vector<char> candidates;
+
+    bool canReuse(const Batch &batch, std::size_t jobCount) const
+    {
+        if (!unit || !(makeParamsKey(*unitTarget) == batch.key)) {
+            return false;
+        }
+        // Every slot of the unit is computed, so don't waste most of them.
+        std::size_t capacity = unit->getBatchSize();
+        std::size_t count = std::min(jobCount, maxUnitSize);
+        return count <= capacity && 2 * count > capacity;
+    }
+
+    static std::size_t countUncracked(const Batch &batch)
+    {
+        std::size_t count = 0;
+        for (const auto &job : batch.jobs) {
+            if (!job.target->cracked) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+public:
+    BatchRunner(std::size_t deviceIndex, std::size_t maxBatchMemory)
+        : deviceIndex(deviceIndex), maxBatchMemory(maxBatchMemory)
+    {
+    }
+
+    BatchRunner(const BatchRunner &) = delete;
+    BatchRunner &operator=(const BatchRunner &) = delete;
+
+    // Run hashes every job of the batch and calls onMatch with the index of
+    // each job whose result equals its target's tag. Jobs may belong to
+    // different targets (salts) as long as they share the batch's
+    // ParamsKey. A batch that does not fit into the unit at once is split
+    // into back-to-back launches on the same unit.
+    //
+    // Jobs whose target is cracked by the time their launch is packed are
+    // skipped, and the slots go to the jobs of other targets.
+    void run(const Batch &batch, const std::function<void(std::size_t)> &onMatch)
+    {
+        std::size_t jobCount = countUncracked(batch);
+        if (jobCount == 0) {
+            return;
+        }
+
+        if (!canReuse(batch, jobCount)) {
+            auto &cache = ContextCache<Device, GlobalContext, ProgramContext>::instance();
+            const Device &device = cache.getDevice(deviceIndex);
+            const ProgramContext *progCtx = &cache.getProgramContext(
+                deviceIndex, batch.key.type, batch.key.version);
+
+            // Free the old buffers before allocating new ones, and before
+            // asking how much memory is left.
+            unit.reset();
+
+            // Any job's params describe the memory layout of the whole batch.
+            unitTarget = batch.jobs[0].target;
+
+            maxUnitSize = getMaxUnitSize(*progCtx, device, Compare());
+            if (maxUnitSize == 0) {
+                throw std::runtime_error("Not enough device memory for a single hash");
+            }
+            maxUnitSize = std::min(maxUnitSize, getBatchSize(unitTarget->params, maxBatchMemory));
+
+            std::size_t unitSize = std::min(jobCount, maxUnitSize);
+            if (unitSize >= std::min(MinSpecializedBatchSize, maxUnitSize)) {
+                progCtx = getSpecializedProgram(batch, progCtx, Specialize());
+            }
+            unit.reset(createUnit(*progCtx, device, unitSize, Compare()));
+        }
+
+        std::size_t unitSize = unit->getBatchSize();
+        std::size_t next = 0;
+        while (next < batch.jobs.size()) {
+            launchJobs.clear();
+            for (; next < batch.jobs.size() && launchJobs.size() < unitSize; next++) {
+                if (!batch.jobs[next].target->cracked) {
+                    launchJobs.push_back(next);
+                }
+            }
+            if (!launchJobs.empty()) {
+                runJobs(batch, onMatch);
+            }
+        }
+    }
+
+private:
+    // RunJobs hashes the launchJobs of the batch in one launch.
+    void runJobs(const Batch &batch, const std::function<void(std::size_t)> &onMatch)
+    {
+        std::size_t count = launchJobs.size();
+        jobParams.resize(count);
+        std::vector<const void *> pws(count);
+        std::vector<std::size_t> pwSizes(count);
+        std::size_t maxLength = batch.source ? batch.source->getMaxLength() : 0;
+        candidates.resize(count * maxLength);
+        for (std::size_t i = 0; i < count; i++) {
+            const Job &job = batch.jobs[launchJobs[i]];
+            jobParams[i] = &job.target->params;
+            if (batch.source) {
+                char *candidate = candidates.data() + i * maxLength;
+                pws[i] = candidate;
+                pwSizes[i] = batch.source->generate(job.index, candidate);
+            } else {
+                pws[i] = job.candidate.data();
+                pwSizes[i] = job.candidate.size();
+            }
+        }
+        unit->setPasswords(0, count, pws.data(), pwSizes.data(), jobParams.data());
+
+        compare(batch, onMatch, Compare());
+    }
+
+    const ProgramContext *getSpecializedProgram(const Batch &batch,
+                                                const ProgramContext *generic,
+                                                std::true_type)
+    {
+        auto &cache = ContextCache<Device, GlobalContext, ProgramContext>::instance();
+        const ProgramContext *specialized = cache.getSpecializedProgramContext(
+            deviceIndex, batch.key.type, batch.key.version, unitTarget->params);
+        return specialized ? specialized : generic;
+    }
+
+    const ProgramContext *getSpecializedProgram(const Batch &, const ProgramContext *generic,
+                                                std::false_type)
+    {
+        return generic;
+    }
+
+    // The unit options have to match those of createUnit below.
+    std::size_t getMaxUnitSize(const ProgramContext &progCtx, const Device &device,
+                               std::false_type)
+    {
+        return ProcessingUnit::getMaxBatchSize(&progCtx, &unitTarget->params, &device,
+                                               false, false);
+    }
+
+    std::size_t getMaxUnitSize(const ProgramContext &progCtx, const Device &device,
+                               std::true_type)
+    {
+        return ProcessingUnit::getMaxBatchSize(&progCtx, &unitTarget->params, &device,
+                                               false, false, 1, true);
+    }
+
+    // I might be mistaken, but enabling precomputation actually decreases the performance.
+    ProcessingUnit *createUnit(const ProgramContext &progCtx, const Device &device,
+                               std::size_t batchSize, std::false_type)
+    {
+        return new ProcessingUnit(&progCtx, &unitTarget->params, &device,
+                                  batchSize, false, false);
+    }
+
+    ProcessingUnit *createUnit(const ProgramContext &progCtx, const Device &device,
+                               std::size_t batchSize, std::true_type)
+    {
+        return new ProcessingUnit(&progCtx, &unitTarget->params, &device,
+                                  batchSize, false, false, 1, true);
+    }
+
+    // Uploads the distinct target tags of the jobs and points every job at
+    // its own target, so the device reads back just the matching job indices.
+    void compare(const Batch &batch, const std::function<void(std::size_t)> &onMatch,
+                 std::true_type)
+    {
+        std::size_t count = launchJobs.size();
+        std::map<const Target *, std::uint32_t> targetIndices;
+        std::string tags;
+        for (std::size_t i = 0; i < count; i++) {
+            const Target *target = batch.jobs[launchJobs[i]].target.get();
+            auto it = targetIndices.find(target);
+            if (it == targetIndices.end()) {
+                std::uint32_t index = static_cast<std::uint32_t>(targetIndices.size());
+                it = targetIndices.insert(std::make_pair(target, index)).first;
+                tags += target->tag;
+            }
+            unit->setTarget(i, it->second);
+        }
+        // Slots past the last job still hold earlier candidates; an
+        // out-of-range target makes the device skip them.
+        std::uint32_t targetCount = static_cast<std::uint32_t>(targetIndices.size());
+        for (std::size_t i = count; i < unit->getBatchSize(); i++) {
+            unit->setTarget(i, targetCount);
+        }
+        unit->setTargets(tags.data(), targetCount);
+
+        unit->beginProcessing();
+        unit->endProcessing();
+
+        for (const auto &match : unit->getMatches()) {
+            onMatch(launchJobs[match.jobId]);
+        }
+    }
+
+    void compare(const Batch &batch, const std::function<void(std::size_t)> &onMatch,
+                 std::false_type)
+    {
+        unit->beginProcessing();
+        unit->endProcessing();
+
+        std::size_t count = launchJobs.size();
+        std::unique_ptr<uint8_t[]> computedHashes(new uint8_t[count * batch.key.outputLength]);
+        std::vector<void *> hashes(count);
+        for (std::size_t i = 0; i < count; i++) {
+            hashes[i] = computedHashes.get() + i * batch.key.outputLength;
+        }
+        unit->getHashes(0, count, hashes.data(), jobParams.data());
+
+        for (std::size_t i = 0; i < count; i++) {
+            const Job &job = batch.jobs[launchJobs[i]];
+            if (std::memcmp(job.target->tag.data(), hashes[i], batch.key.outputLength) == 0) {
+                onMatch(launchJobs[i]);
+            }
+        }
+    }
+};
+
+// RunBatch runs a single batch on the given device with a fresh unit of at
+// most maxBatchMemory bytes
+template <class Device, class GlobalContext, class ProgramContext, class ProcessingUnit>
+void runBatch(
+    const Batch &batch,
+    std::size_t deviceIndex,
+    std::size_t maxBatchMemory,
+    const std::function<void(std::size_t)> &onMatch
+){
+    BatchRunner<Device, GlobalContext, ProgramContext, ProcessingUnit> runner(deviceIndex, maxBatchMemory);
+    runner.run(batch, onMatch);
+}
+
+#endif // BATCH_RUNNER_H
@@ -0,0 +1,33 @@
+#ifndef CANDIDATE_SOURCE_H
+#define CANDIDATE_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+// CandidateSource generates candidates on demand from their index, so that
+// jobs only have to carry the index and candidates are only ever written
+// into the buffer of the launch that hashes them. Implementations are
+// immutable once shared and may be used from several threads at once.
+class CandidateSource
+{
+public:
+    virtual ~CandidateSource() {}
+
+    // The length of the longest candidate
+    virtual std::size_t getMaxLength() const = 0;
+
+    // Generate writes the candidate with the given index to out, which has
+    // to hold getMaxLength() bytes, and returns its length
+    virtual std::size_t generate(std::uint64_t index, char *out) const = 0;
+
+    std::string getCandidate(std::uint64_t index) const
+    {
+        std::string candidate(getMaxLength(), '\0');
+        candidate.resize(generate(index, &candidate[0]));
+        return candidate;
+    }
+};
+
+#endif // CANDIDATE_SOURCE_H
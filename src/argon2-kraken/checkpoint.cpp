@@ -0,0 +1,199 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "checkpoint.hpp"
+
+
+static const char *const CheckpointHeader = "argon2-kraken checkpoint 1";
+
+Checkpoint::Checkpoint(const std::string &path, const std::string &leftlist,
+                       const std::string &candidates)
+    : path(path), leftlist(leftlist), candidates(candidates),
+      readPosition(InputPosition { 0, 0, 0 }),
+      lastSave(std::chrono::steady_clock::now())
+{
+}
+
+InputPosition Checkpoint::getRestartPosition() const
+{
+    if (openBatches.empty()) {
+        return readPosition;
+    }
+    return openBatches.begin()->second;
+}
+
+void Checkpoint::restore()
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open checkpoint " + path);
+    }
+
+    std::string line;
+    if (!std::getline(file, line) || line != CheckpointHeader) {
+        throw std::runtime_error("Not a checkpoint file: " + path);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    bool havePosition = false;
+    while (std::getline(file, line)) {
+        std::size_t space = line.find(' ');
+        std::string field = line.substr(0, space);
+        std::string value = space == std::string::npos ? "" : line.substr(space + 1);
+        std::istringstream values(value);
+
+        if (field == "leftlist" || field == "candidates") {
+            if (value != (field == "leftlist" ? leftlist : candidates)) {
+                throw std::runtime_error("The checkpoint " + path + " belongs to other input (" + field + " " + value + ")");
+            }
+        } else if (field == "position") {
+            InputPosition position;
+            if (!(values >> position.line >> position.leftlistOffset >> position.wordlistOffset)) {
+                throw std::runtime_error("Malformed position in checkpoint " + path);
+            }
+            readPosition = position;
+            havePosition = true;
+        } else if (field == "finished") {
+            int type, version;
+            ParamsKey key;
+            std::size_t firstLine, lastLine;
+            if (!(values >> type >> version >> key.outputLength >> key.timeCost
+                         >> key.memoryCost >> key.lanes >> firstLine >> lastLine)) {
+                throw std::runtime_error("Malformed batch in checkpoint " + path);
+            }
+            key.type = static_cast<argon2::Type>(type);
+            key.version = static_cast<argon2::Version>(version);
+            finished[key][firstLine] = lastLine;
+        }
+    }
+    if (!havePosition) {
+        throw std::runtime_error("Checkpoint " + path + " has no position");
+    }
+}
+
+InputPosition Checkpoint::getStartPosition()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return readPosition;
+}
+
+bool Checkpoint::isFinished(const ParamsKey &key, std::size_t line)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto ranges = finished.find(key);
+    if (ranges == finished.end()) {
+        return false;
+    }
+
+    // The last range that starts at or before the line
+    auto range = ranges->second.upper_bound(line);
+    if (range == ranges->second.begin()) {
+        return false;
+    }
+    --range;
+    return line <= range->second;
+}
+
+void Checkpoint::lineRead(const InputPosition &next)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    readPosition = next;
+}
+
+void Checkpoint::batchOpened(const InputPosition &start)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    openBatches[start.line + 1] = start;
+}
+
+void Checkpoint::batchFinished(const Batch &batch)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    openBatches.erase(batch.firstLine);
+
+    // A batch read after a restore may enclose the ranges finished before,
+    // whose lines it skipped.
+    auto &ranges = finished[batch.key];
+    auto range = ranges.lower_bound(batch.firstLine);
+    while (range != ranges.end() && range->first <= batch.lastLine) {
+        range = ranges.erase(range);
+    }
+    ranges[batch.firstLine] = batch.lastLine;
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastSave >= CheckpointInterval) {
+        write();
+        lastSave = now;
+    }
+}
+
+void Checkpoint::save()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    write();
+    lastSave = std::chrono::steady_clock::now();
+}
+
+void Checkpoint::remove()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::remove(path.c_str());
+}
+
+void Checkpoint::write()
+{
+    InputPosition restart = getRestartPosition();
+
+    // Ranges that end before the restart position are not needed anymore.
+    for (auto ranges = finished.begin(); ranges != finished.end();) {
+        for (auto range = ranges->second.begin(); range != ranges->second.end();) {
+            if (range->second <= restart.line) {
+                range = ranges->second.erase(range);
+            } else {
+                ++range;
+            }
+        }
+        if (ranges->second.empty()) {
+            ranges = finished.erase(ranges);
+        } else {
+            ++ranges;
+        }
+    }
+
+    // Write to a private file first and rename it into place, so that a
+    // crash never leaves a partially written checkpoint behind.
+    std::string tmpPath = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        file << CheckpointHeader << "\n"
+             << "leftlist " << leftlist << "\n"
+             << "candidates " << candidates << "\n"
+             << "position " << restart.line << " " << restart.leftlistOffset
+             << " " << restart.wordlistOffset << "\n";
+        for (const auto &ranges : finished) {
+            const ParamsKey &key = ranges.first;
+            for (const auto &range : ranges.second) {
+                file << "finished " << static_cast<int>(key.type) << " "
+                     << static_cast<int>(key.version) << " " << key.outputLength
+                     << " " << key.timeCost << " " << key.memoryCost << " "
+                     << key.lanes << " " << range.first << " " << range.second << "\n";
+            }
+        }
+        file.flush();
+        if (!file) {
+            std::cerr << "WARNING: Cannot write checkpoint " << tmpPath << std::endl;
+            file.close();
+            std::remove(tmpPath.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "WARNING: Cannot write checkpoint " << path << std::endl;
+        std::remove(tmpPath.c_str());
+    }
+}
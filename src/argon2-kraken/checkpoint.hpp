@@ -0,0 +1,100 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "batch.hpp"
+
+
+// InputPosition is a point in the paired input files: the number of lines
+// read so far and the byte offsets of the next line in each file. With
+// rules the line is a position in the lines x rules product (and the
+// offsets are those of the line it falls into). In mask mode only the line
+// (the position in the hashes x keyspace product) is used.
+struct InputPosition
+{
+    std::size_t line;
+    std::uint64_t leftlistOffset;
+    std::uint64_t wordlistOffset;
+};
+
+// How often the progress of a run is written out (at most).
+const std::chrono::seconds CheckpointInterval(60);
+
+// Checkpoint tracks which input lines have been fully processed and
+// periodically saves that to a file, so an interrupted run can be resumed.
+//
+// Batches finish out of order and a batch of a rare parameter set may stay
+// pending for a long time, so the file holds the position of the first line
+// of the oldest unfinished batch (everything before it is done) plus the
+// line ranges of the batches already finished after it. Together with the
+// potfile, this is enough to skip all the finished work on restore.
+class Checkpoint
+{
+private:
+    std::string path;
+    std::string leftlist;
+    std::string candidates;
+
+    std::mutex mutex;
+    InputPosition readPosition;
+
+    // Start positions of the batches that were not finished yet, by their
+    // first line
+    std::map<std::size_t, InputPosition> openBatches;
+
+    // Finished batches that end past the restart position, by key and
+    // first line
+    std::map<ParamsKey, std::map<std::size_t, std::size_t>> finished;
+
+    std::chrono::steady_clock::time_point lastSave;
+
+    InputPosition getRestartPosition() const;
+    void write();
+
+public:
+    // The checkpoint of a run over the given leftlist and candidates (the
+    // wordlist, or a description of the mask) is kept in path
+    Checkpoint(const std::string &path, const std::string &leftlist,
+               const std::string &candidates);
+
+    Checkpoint(const Checkpoint &) = delete;
+    Checkpoint &operator=(const Checkpoint &) = delete;
+
+    // Restore loads the progress of an earlier run; throws
+    // std::runtime_error if the file is missing, malformed or belongs to
+    // other input files
+    void restore();
+
+    // GetStartPosition returns where reading the input has to start
+    InputPosition getStartPosition();
+
+    // IsFinished tells whether the given line (with the given key) was
+    // already hashed in a batch that finished
+    bool isFinished(const ParamsKey &key, std::size_t line);
+
+    // LineRead records that the input was read up to the given position
+    void lineRead(const InputPosition &next);
+
+    // BatchOpened records that a batch starting at the given position (its
+    // first line) was created
+    void batchOpened(const InputPosition &start);
+
+    // BatchFinished records that every job of the batch was hashed and its
+    // matches written to the potfile, and saves the checkpoint if the last
+    // save is older than CheckpointInterval
+    void batchFinished(const Batch &batch);
+
+    // Save writes the checkpoint now
+    void save();
+
+    // Remove deletes the checkpoint file once the run is complete
+    void remove();
+};
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,131 @@
+#ifndef CONTEXT_CACHE_H
+#define CONTEXT_CACHE_H
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "argon2-gpu-common/argon2-common.h"
+#include "argon2-gpu-common/argon2params.h"
+
+
+// ContextCache owns the long-lived backend state shared by all workers: one
+// GlobalContext per backend (i.e. per template instantiation) and one
+// ProgramContext per (device, type, version), plus one per parameter set
+// that a specialized program was asked for. Building a ProgramContext
+// compiles the Argon2 kernel, so this makes every kernel variant compile
+// once per process instead of once per hash.
+template <class Device, class GlobalContext, class ProgramContext>
+class ContextCache
+{
+private:
+    // Generic programs have zero passes, lanes and segment blocks.
+    typedef std::tuple<std::size_t, argon2::Type, argon2::Version,
+                       std::uint32_t, std::uint32_t, std::uint32_t> ProgramKey;
+
+    struct ProgramEntry
+    {
+        std::once_flag built;
+        // Stays null if a specialized program failed to build.
+        std::unique_ptr<ProgramContext> context;
+    };
+
+    std::once_flag globalBuilt;
+    std::unique_ptr<GlobalContext> global;
+
+    std::mutex programsMutex;
+    std::map<ProgramKey, std::unique_ptr<ProgramEntry>> programs;
+
+    ContextCache() = default;
+
+public:
+    ContextCache(const ContextCache &) = delete;
+    ContextCache &operator=(const ContextCache &) = delete;
+
+    static ContextCache &instance()
+    {
+        static ContextCache cache;
+        return cache;
+    }
+
+    const GlobalContext &getGlobalContext()
+    {
+        std::call_once(globalBuilt, [this] {
+            global.reset(new GlobalContext());
+        });
+        return *global;
+    }
+
+    const std::vector<Device> &getAllDevices()
+    {
+        return getGlobalContext().getAllDevices();
+    }
+
+    const Device &getDevice(std::size_t deviceIndex)
+    {
+        auto &devices = getAllDevices();
+        if (deviceIndex >= devices.size()) {
+            throw std::runtime_error("Device index out of range");
+        }
+        return devices[deviceIndex];
+    }
+
+    // Returns the program for the given device, building it on first use.
+    // Concurrent callers asking for the same key wait for a single build;
+    // callers asking for different keys do not block each other.
+    const ProgramContext &getProgramContext(
+        std::size_t deviceIndex, argon2::Type type, argon2::Version version)
+    {
+        const Device &device = getDevice(deviceIndex);
+
+        ProgramEntry *entry = getEntry(ProgramKey(deviceIndex, type, version, 0, 0, 0));
+        std::call_once(entry->built, [&] {
+            entry->context.reset(new ProgramContext(
+                &getGlobalContext(), {device}, type, version));
+        });
+        return *entry->context;
+    }
+
+    // Like getProgramContext, but the program is specialized for the cost
+    // parameters of params (only for backends that support it). If it fails
+    // to build, a warning is printed once and nullptr is returned for the
+    // key from then on, so the caller can fall back to the generic program.
+    const ProgramContext *getSpecializedProgramContext(
+        std::size_t deviceIndex, argon2::Type type, argon2::Version version,
+        const argon2::Argon2Params &params)
+    {
+        const Device &device = getDevice(deviceIndex);
+
+        ProgramEntry *entry = getEntry(ProgramKey(
+            deviceIndex, type, version,
+            params.getTimeCost(), params.getLanes(), params.getSegmentBlocks()));
+        std::call_once(entry->built, [&] {
+            try {
+                entry->context.reset(new ProgramContext(
+                    &getGlobalContext(), {device}, type, version, params));
+            } catch (const std::exception &err) {
+                std::cerr << "WARNING: Failed to build a specialized program, "
+                          << "using the generic one - " << err.what() << std::endl;
+            }
+        });
+        return entry->context.get();
+    }
+
+private:
+    ProgramEntry *getEntry(const ProgramKey &key)
+    {
+        std::lock_guard<std::mutex> lock(programsMutex);
+        auto &slot = programs[key];
+        if (!slot) {
+            slot.reset(new ProgramEntry());
+        }
+        return slot.get();
+    }
+};
+
+#endif // CONTEXT_CACHE_H
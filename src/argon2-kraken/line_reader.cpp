@@ -0,0 +1,30 @@
+#include "line_reader.hpp"
+
+
+LineReader::LineReader(const std::string &path)
+    : buffer(new char[BufferSize])
+{
+    // The buffer has to be installed before the file is opened.
+    file.rdbuf()->pubsetbuf(buffer.get(), BufferSize);
+    file.open(path, std::ios::in | std::ios::binary);
+}
+
+bool LineReader::next(std::string &line)
+{
+    if (!std::getline(file, line)) {
+        return false;
+    }
+    // The last line may lack its newline.
+    offset += line.length() + (file.eof() ? 0 : 1);
+    if (!line.empty() && line[line.length() - 1] == '\r') {
+        line.pop_back();
+    }
+    return true;
+}
+
+void LineReader::seek(std::uint64_t offset)
+{
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(offset));
+    this->offset = offset;
+}
@@ -0,0 +1,38 @@
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+
+
+// LineReader reads a text file line by line through a large read buffer,
+// so only the current line is ever held in memory. Both LF and CRLF line
+// endings are accepted.
+class LineReader
+{
+private:
+    std::unique_ptr<char[]> buffer;
+    std::ifstream file;
+    std::uint64_t offset = 0;
+
+public:
+    static const std::size_t BufferSize = std::size_t(1) << 20;
+
+    explicit LineReader(const std::string &path);
+
+    bool isOpen() const { return file.is_open(); }
+
+    // Returns false at end of file
+    bool next(std::string &line);
+
+    // GetOffset returns the byte offset of the next line
+    std::uint64_t getOffset() const { return offset; }
+
+    // Seek continues reading at the given byte offset, which has to be the
+    // start of a line (as returned by getOffset)
+    void seek(std::uint64_t offset);
+};
+
+#endif // LINE_READER_H
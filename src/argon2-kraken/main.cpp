@@ -4,208 +4,482 @@
 #include <map>
 #include <future>
 #include <algorithm>
+#include <functional>
 
 #define CL_TARGET_OPENCL_VERSION 300
 
+#include "commandline/commandlineparser.h"
+#include "commandline/argumenthandlers.h"
+
 #include "argon2-gpu-common/argon2params.h"
+#include "argon2-gpu-common/tuningcache.h"
 #include "argon2-opencl/processingunit.h"
 #include "argon2-cuda/processingunit.h"
+#include "argon2-cpu/processingunit.h"
 #include "argon2.h"
 
 #include "hash_parser.hpp"
 #include "base64.hpp"
 #include "strings_tools.hpp"
+#include "target.hpp"
+#include "batch.hpp"
+#include "batch_runner.hpp"
+#include "bounded_queue.hpp"
+#include "scheduler.hpp"
+#include "task_reader.hpp"
+#include "potfile.hpp"
+#include "checkpoint.hpp"
+#include "mask.hpp"
+#include "rules.hpp"
 
 
-// In Argon2, the memory size is defined in kilobytes, and the amount of memory used
-// is calculated as m times the block size r times the parallelism p.
-//
-// The block size r is a fixed parameter in Argon2 and is equal to 1024 bytes.
-// Therefore, with m=65536 and a parallelism factor of p=1, the amount of memory used
-// would be m*r*p = 65536*1024*1 = 67,108,864 bytes or 64 MB.
-//
-// TODO: Detect amount of workers based on available GPU memory.
-// 1080TI I use for testing has 11264 MB of on board memory, example of the hash used for testing:
-//
-// >> $argon2id$v=19$m=65536,t=1,p=4$qK32Vuin0v8USlgec6lDFw$w5yjWJqZxCfM4EO3S9jBONpfCx0EBlyxd3MfRFhdn6U
-//
-// 65536*1024*4 == 268Mb
-// 11264 / 268 == 42 (lol)
-//
-// BUT! At least in case of 1080TI we are not getting anywhere close to this memory utilization
-// (floats around 20%), as GPU chip itself is a bottleneck that is being used up to 99%.
-const int MaxWorkers = 42;
-
+using namespace libcommandline;
 
-template <class Device, class GlobalContext, class ProgramContext, class ProcessingUnit>
-Device getDeviceToUse()
+struct Arguments
 {
-    GlobalContext global;
-    auto &devices = global.getAllDevices();
-    return devices[0];
-}
+    std::vector<std::string> positional;
+
+    // Indices of the devices to use; empty means all of them
+    std::vector<std::size_t> devices;
+
+    // Where to keep the autotuning results; empty means the library default
+    std::string tuningCache;
+    bool retune = false;
+
+    // "association" pairs the leftlist with the wordlist line by line,
+    // "cross" tries every hash against every word of the wordlist and
+    // "mask" against every candidate of a mask
+    std::string attack = "association";
+
+    // Mask mode: the custom charsets ?1 to ?4, the candidate lengths
+    // (zero means the length of the mask) and the range of the keyspace
+    // to try (a zero limit means up to its end)
+    std::vector<std::string> customCharsets = std::vector<std::string>(Mask::CustomCharsets);
+    bool increment = false;
+    std::size_t incrementMin = 1;
+    std::size_t incrementMax = 0;
+    std::uint64_t skip = 0;
+    std::uint64_t limit = 0;
+
+    // The rule file to apply to every word of the wordlist; empty means
+    // none
+    std::string rules;
+
+    // Where to keep the progress of the run; empty means POTFILE.restore
+    std::string checkpoint;
+    bool restore = false;
+
+    bool showHelp = false;
+    bool listDevices = false;
+};
+
+// SelectDevices returns the indices of the requested devices, or of all
+// devices of the backend if none were requested
+template <class Device, class GlobalContext, class ProgramContext>
+std::vector<std::size_t> selectDevices(const std::vector<std::size_t> &requested)
+{
+    auto &devices = ContextCache<Device, GlobalContext, ProgramContext>::instance().getAllDevices();
+    if (devices.empty()) {
+        throw std::runtime_error("No devices found");
+    }
 
-template <typename Device, typename GlobalContext, typename ProgramContext, typename ProcessingUnit>
-int compareHashImpl(
-    const std::vector<std::string> &passwords, 
-    const std::string &hash, 
-    const argon2::Argon2Params &params, 
-    argon2::Type &type, 
-    argon2::Version &version
-){
-    Device device = getDeviceToUse<Device, GlobalContext, ProgramContext, ProcessingUnit>();
-    GlobalContext global;
-    ProgramContext progCtx(&global, {device}, type, version);
-    // I might be mistaken, but enabling precomputation actually decreases the performance.
-    ProcessingUnit processingUnit(&progCtx, &params, &device, passwords.size(), false, false);
-    std::unique_ptr<uint8_t[]> computedHash(new uint8_t[params.getOutputLength() * passwords.size()]);
-
-    for (std::size_t i = 0; i < passwords.size(); i++) {
-        processingUnit.setPassword(i, passwords[i].data(), passwords[i].size());
-    }
-    
-    processingUnit.beginProcessing();
-    processingUnit.endProcessing();
-
-    for (std::size_t i = 0; i < passwords.size(); i++) {
-        processingUnit.getHash(i, computedHash.get() + i * params.getOutputLength());
-
-        if (std::memcmp(hash.data(), computedHash.get() + i * params.getOutputLength(), params.getOutputLength()) == 0) {
-            return i;
+    std::vector<std::size_t> selected;
+    if (requested.empty()) {
+        for (std::size_t i = 0; i < devices.size(); i++) {
+            selected.push_back(i);
         }
+        return selected;
     }
 
-    return -1;
+    for (std::size_t index : requested) {
+        if (index >= devices.size()) {
+            throw std::runtime_error("Device index " + std::to_string(index) + " out of range");
+        }
+        if (std::find(selected.begin(), selected.end(), index) == selected.end()) {
+            selected.push_back(index);
+        }
+    }
+    return selected;
 }
 
-extern "C" int Compare(const std::string &mode, const std::string &hash, const std::vector<std::string> &passwords)
+template <class Device, class GlobalContext, class ProgramContext>
+void listDevices()
 {
-    Argon2ParamsData paramsData = parseArgon2Hash(hash);
-
-    std::size_t saltSize = paramsData.salt.length();
-
-    // TODO: Why do we get null in it and why .length() counts it in?
-    if (paramsData.salt[saltSize-1] == 0) {
-        saltSize -= 1;
+    auto &devices = ContextCache<Device, GlobalContext, ProgramContext>::instance().getAllDevices();
+    for (std::size_t i = 0; i < devices.size(); i++) {
+        std::cout << "Device #" << i << ": " << devices[i].getName() << std::endl;
     }
+}
 
-    const void *salt_pointer = static_cast<const void *>(paramsData.salt.c_str());
-    argon2::Argon2Params params(
-        paramsData.hash.length() / 2, 
-        salt_pointer, saltSize, 
-        nullptr, 0, 
-        nullptr, 0, 
-        paramsData.timeCost, paramsData.memoryCost, paramsData.parallelism);
-
-    std::string hexHash = hexToString(paramsData.hash);
+template <typename Device, typename GlobalContext, typename ProgramContext, typename ProcessingUnit>
+void runBatchImpl(const Batch &batch, const std::function<void(std::size_t)> &onMatch)
+{
+    std::size_t deviceIndex = selectDevices<Device, GlobalContext, ProgramContext>({})[0];
+    auto &cache = ContextCache<Device, GlobalContext, ProgramContext>::instance();
+    std::size_t maxBatchMemory = getMaxBatchMemory(getDeviceLimits(cache.getDevice(deviceIndex)));
+    runBatch<Device, GlobalContext, ProgramContext, ProcessingUnit>(batch, deviceIndex, maxBatchMemory, onMatch);
+}
 
+// RunBatchOn dispatches a batch to the backend selected by mode
+void runBatchOn(const std::string &mode, const Batch &batch, const std::function<void(std::size_t)> &onMatch)
+{
     if (mode == "opencl") {
-        return compareHashImpl<argon2::opencl::Device, argon2::opencl::GlobalContext, argon2::opencl::ProgramContext, argon2::opencl::ProcessingUnit>(
-            passwords, hexHash, params, paramsData.type, paramsData.version
+        runBatchImpl<argon2::opencl::Device, argon2::opencl::GlobalContext, argon2::opencl::ProgramContext, argon2::opencl::ProcessingUnit>(
+            batch, onMatch
         );
     } else if (mode == "cuda") {
-        return compareHashImpl<argon2::cuda::Device, argon2::cuda::GlobalContext, argon2::cuda::ProgramContext, argon2::cuda::ProcessingUnit>(
-            passwords, hexHash, params, paramsData.type, paramsData.version
+        runBatchImpl<argon2::cuda::Device, argon2::cuda::GlobalContext, argon2::cuda::ProgramContext, argon2::cuda::ProcessingUnit>(
+            batch, onMatch
+        );
+    } else if (mode == "cpu") {
+        runBatchImpl<argon2::cpu::Device, argon2::cpu::GlobalContext, argon2::cpu::ProgramContext, argon2::cpu::ProcessingUnit>(
+            batch, onMatch
         );
     } else {
-        std::cout << "Unknwon mode " << mode << " user cuda or opencl" << std::endl;
+        std::cout << "Unknwon mode " << mode << " user cuda, opencl or cpu" << std::endl;
     }
-
-    return -1;
 }
 
-std::map<std::string, std::vector<std::string>> buildTasks(std::string leftlist, std::string wordlist){
-    // TODO: AS of right now we load entire LL and WL in memory, will not fly for bigger hashlists
+extern "C" int Compare(const std::string &mode, const std::string &hash, const std::vector<std::string> &passwords)
+{
+    std::shared_ptr<Target> target = parseTarget(hash);
 
-    // Open the input files.
-    std::ifstream llFile(leftlist);
-    if (!llFile.is_open()) {
-        throw std::runtime_error("Cannot open llFile");
+    Batch batch { makeParamsKey(*target), {}, 0, 0, nullptr };
+    for (const auto &password : passwords) {
+        batch.jobs.push_back(Job { target, password, 0 });
     }
 
-    std::ifstream wlFile(wordlist);
-    if (!wlFile.is_open()) {
-        throw std::runtime_error("Cannot open wlFile");
+    // Marking the target cracked skips the launches still to come.
+    int found = -1;
+    runBatchOn(mode, batch, [&found, &target](std::size_t i) {
+        if (found < 0) {
+            found = static_cast<int>(i);
+        }
+        target->cracked = true;
+    });
+    return found;
+}
+
+static std::shared_ptr<const Mask> makeMask(const Arguments &args)
+{
+    if (args.increment) {
+        return std::make_shared<const Mask>(args.positional[2], args.customCharsets,
+                                            args.incrementMin, args.incrementMax);
     }
+    return std::make_shared<const Mask>(args.positional[2], args.customCharsets);
+}
+
+// DescribeMask identifies the candidates of a mask run in its checkpoint
+static std::string describeMask(const Arguments &args, std::uint64_t begin, std::uint64_t end)
+{
+    std::string description = "mask " + args.positional[2];
+    for (std::size_t i = 0; i < args.customCharsets.size(); i++) {
+        if (!args.customCharsets[i].empty()) {
+            description += " -" + std::to_string(i + 1) + " " + args.customCharsets[i];
+        }
+    }
+    if (args.increment) {
+        description += " increment " + std::to_string(args.incrementMin)
+                + "-" + std::to_string(args.incrementMax);
+    }
+    return description + " range " + std::to_string(begin) + "-" + std::to_string(end);
+}
 
-    std::map<std::string, std::vector<std::string>> data;
+// Crack streams the input files through a bounded queue into pools of
+// persistent workers on every selected device (pairing the leftlist with
+// the wordlist line by line, or trying every hash against every word or
+// every candidate of a mask) and appends every cracked
+// hash to the potfile. Hashes already in the potfile are skipped, the
+// candidates of a hash are dropped as soon as it is cracked, and the
+// progress is checkpointed so that an interrupted run can be resumed with
+// --restore.
+//
+// In Argon2 the memory used per hash is m KiB, so e.g. m=65536,p=4 takes
+// 64 MiB and a 11 GiB card holds ~170 such hashes. Every worker gets the
+// same memory share (maxBatchMemory, the smallest share over the selected
+// devices), which bounds both the batches and the worker's unit; the
+// number of workers per device is then how many such shares fit on it.
+template <typename Device, typename GlobalContext, typename ProgramContext, typename ProcessingUnit>
+void crack(const Arguments &args)
+{
+    auto &cache = ContextCache<Device, GlobalContext, ProgramContext>::instance();
+    std::vector<std::size_t> deviceIndices = selectDevices<Device, GlobalContext, ProgramContext>(args.devices);
+
+    // Any device may pick up any batch, so the smallest device decides the
+    // batch size.
+    std::vector<DeviceLimits> limits;
+    std::size_t maxBatchMemory = 0;
+    for (std::size_t index : deviceIndices) {
+        limits.push_back(getDeviceLimits(cache.getDevice(index)));
+
+        std::size_t memory = getMaxBatchMemory(limits.back());
+        if (maxBatchMemory == 0 || memory < maxBatchMemory) {
+            maxBatchMemory = memory;
+        }
+    }
 
-    // Read the input files and add jobs to the vector.
-    std::string hash, plain;
-    while (std::getline(llFile, hash) && std::getline(wlFile, plain)) {
-        plain = plain.substr(0, plain.length() - 1);
-        data[hash].push_back(plain);
+    std::vector<DeviceWorkers> workers;
+    std::size_t workerCount = 0;
+    for (std::size_t i = 0; i < deviceIndices.size(); i++) {
+        workers.push_back(DeviceWorkers { deviceIndices[i], getWorkerCount(limits[i], maxBatchMemory) });
+        workerCount += workers.back().workerCount;
     }
 
-    llFile.close();
-    wlFile.close();
+    std::shared_ptr<const Mask> mask;
+    std::shared_ptr<const RuleSet> rules;
+    std::uint64_t maskBegin = 0, maskEnd = 0;
+    // The checkpoint positions of the modes differ.
+    std::string candidates = args.attack == "cross" ? "cross " + args.positional[2] : args.positional[2];
+    if (!args.rules.empty()) {
+        if (args.attack == "mask") {
+            throw std::runtime_error("Rules need a wordlist, not a mask");
+        }
+        rules = std::make_shared<const RuleSet>(args.rules);
+        candidates += " rules " + args.rules;
+    }
+    if (args.attack == "mask") {
+        mask = makeMask(args);
+        maskBegin = args.skip;
+        maskEnd = mask->getKeyspace();
+        if (maskBegin >= maskEnd) {
+            throw std::runtime_error("--skip is past the end of the keyspace ("
+                                     + std::to_string(maskEnd) + " candidates)");
+        }
+        if (args.limit != 0 && args.limit < maskEnd - maskBegin) {
+            maskEnd = maskBegin + args.limit;
+        }
+        candidates = describeMask(args, maskBegin, maskEnd);
+    }
 
-    return data;
-}
+    const std::string &potfilePath = args.positional[3];
+    Checkpoint checkpoint(args.checkpoint.empty() ? potfilePath + ".restore" : args.checkpoint,
+                          args.positional[1], candidates);
+    if (args.restore) {
+        checkpoint.restore();
+    }
 
-// Worker function that takes a task and a mutex to protect the output stream
-void worker(
-    const std::string& taskName, 
-    const std::vector<std::string>& taskData, 
-    std::string mode,
-    std::ofstream& outfile, 
-    std::mutex& outMutex
-) {
-    int i = Compare(mode, taskName, taskData);
-    if (i >= 0) {
-        // Lock the output stream before writing to it
-        std::unique_lock<std::mutex> lock(outMutex);
-        outfile << taskName << ":" << taskData[i] << std::endl;
+    Potfile potfile(potfilePath);
+
+    // Only a few batches per worker are ever held in memory, no matter how
+    // large the input files are
+    BoundedQueue<Batch> tasks(2 * workerCount);
+    std::future<void> reader;
+    if (mask) {
+        reader = std::async(std::launch::async, readMaskBatches,
+                            args.positional[1], mask, maskBegin, maskEnd, maxBatchMemory,
+                            std::ref(tasks), std::cref(potfile), std::ref(checkpoint));
+    } else if (args.attack == "cross") {
+        reader = std::async(std::launch::async, readCrossBatches,
+                            args.positional[1], args.positional[2], rules, maxBatchMemory,
+                            std::ref(tasks), std::cref(potfile), std::ref(checkpoint));
+    } else {
+        reader = std::async(std::launch::async, readBatches,
+                            args.positional[1], args.positional[2], rules, maxBatchMemory,
+                            std::ref(tasks), std::cref(potfile), std::ref(checkpoint));
     }
-}
 
-void processTasks(
-    const std::map<std::string, std::vector<std::string>> &tasks,
-    const std::string &mode,
-    const std::string &outputFile
-) {
-    std::ofstream outfile(outputFile);
-    std::mutex outMutex;
-    std::vector<std::future<void>> futures;
-
-    for (const auto &task : tasks) {
-        // Wait for a worker to finish if the maximum number of active workers is reached
-        while (futures.size() >= MaxWorkers) {
-            auto it = std::remove_if(futures.begin(), futures.end(), [](std::future<void> &f) {
-                return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    try {
+        runWorkers<Device, GlobalContext, ProgramContext, ProcessingUnit>(
+            workers, maxBatchMemory, tasks, [&potfile](const Job &job, const std::string &candidate) {
+                // Only the first candidate that cracks a given hash is
+                // reported. The target is marked only once its entry is in
+                // the potfile, so a checkpoint never covers dropped
+                // candidates of an unsaved crack.
+                potfile.add(job.target->line, candidate);
+                job.target->cracked = true;
+            }, [&checkpoint](const Batch &batch) {
+                checkpoint.batchFinished(batch);
             });
+    } catch (...) {
+        // Unblock the reader before bailing out
+        tasks.close();
+        reader.wait();
+        checkpoint.save();
+        throw;
+    }
+    try {
+        reader.get();
+    } catch (...) {
+        checkpoint.save();
+        throw;
+    }
 
-            futures.erase(it, futures.end());
+    checkpoint.remove();
+}
 
-            if (futures.size() < MaxWorkers) {
-                break;
-            }
+template <typename Device, typename GlobalContext, typename ProgramContext, typename ProcessingUnit>
+void run(const Arguments &args)
+{
+    if (args.listDevices) {
+        listDevices<Device, GlobalContext, ProgramContext>();
+    } else {
+        crack<Device, GlobalContext, ProgramContext, ProcessingUnit>(args);
+    }
+}
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+static std::vector<std::size_t> parseDeviceList(const std::string &list)
+{
+    std::vector<std::size_t> devices;
+    std::size_t begin = 0;
+    while (begin <= list.size()) {
+        std::size_t end = list.find(',', begin);
+        if (end == std::string::npos) {
+            end = list.size();
         }
 
-        // Create a new worker using std::async
-        futures.emplace_back(std::async(std::launch::async, worker, task.first, task.second, mode, std::ref(outfile), std::ref(outMutex)));
-    }
+        std::string item = list.substr(begin, end - begin);
+        if (item.empty() || item.find_first_not_of("0123456789") != std::string::npos) {
+            throw ArgumentFormatException("expected a comma-separated list of device indices");
+        }
+        devices.push_back(std::stoul(item));
 
-    // Wait for all remaining futures to complete
-    for (auto &f : futures) {
-        f.get();
+        begin = end + 1;
     }
+    return devices;
+}
 
-    outfile.close();
+static CommandLineParser<Arguments> buildCmdLineParser()
+{
+    static const auto positional = PositionalArgumentHandler<Arguments>(
+                [] (Arguments &state, const std::string &arg) {
+                    state.positional.push_back(arg);
+                }, "MODE LEFTLIST WORDLIST POTFILE",
+                "MODE is 'opencl', 'cuda' or 'cpu'; WORDLIST is a mask with --attack=mask");
+
+    std::vector<const CommandLineOption<Arguments>*> options {
+        new FlagOption<Arguments>(
+            [] (Arguments &state) { state.listDevices = true; },
+            "list-devices", 'l', "list all available devices and exit"),
+
+        new ArgumentOption<Arguments>(
+            [] (Arguments &state, const std::string &list) {
+                state.devices = parseDeviceList(list);
+            }, "devices", 'd', "use only the devices with the given comma-separated indices", "all", "LIST"),
+
+        new ArgumentOption<Arguments>(
+            [] (Arguments &state, const std::string &path) {
+                state.tuningCache = path;
+            }, "tuning-cache", 'c', "keep the autotuning results in this file", "~/.cache/argon2-gpu/tuning.txt", "PATH"),
+
+        new FlagOption<Arguments>(
+            [] (Arguments &state) { state.retune = true; },
+            "retune", 'r', "ignore cached autotuning results and tune every configuration again"),
+
+        new ArgumentOption<Arguments>(
+            [] (Arguments &state, const std::string &path) {
+                state.checkpoint = path;
+            }, "checkpoint", '\0', "keep the progress of the run in this file", "POTFILE.restore", "PATH"),
+
+        new FlagOption<Arguments>(
+            [] (Arguments &state) { state.restore = true; },
+            "restore", '\0', "resume the interrupted run recorded in the checkpoint"),
+
+        new ArgumentOption<Arguments>(
+            [] (Arguments &state, const std::string &attack) {
+                if (attack != "association" && attack != "cross" && attack != "mask") {
+                    throw ArgumentFormatException("expected 'association', 'cross' or 'mask'");
+                }
+                state.attack = attack;
+            }, "attack", 'a', "attack mode (association|cross|mask); in mask mode WORDLIST is a mask such as ?u?l?l?d", "association", "MODE"),
+
+        new ArgumentOption<Arguments>(
+            [] (Arguments &state, const std::string &charset) {
+                state.customCharsets[0] = charset;
+            }, "custom-charset1", '1', "define the charset ?1 of the mask", "", "CHARSET"),
+
+        new ArgumentOption<Arguments>(
+            [] (Arguments &state, const std::string &charset) {
+                state.customCharsets[1] = charset;
+            }, "custom-charset2", '2', "define the charset ?2 of the mask", "", "CHARSET"),
+
+        new ArgumentOption<Arguments>(
+            [] (Arguments &state, const std::string &charset) {
+                state.customCharsets[2] = charset;
+            }, "custom-charset3", '3', "define the charset ?3 of the mask", "", "CHARSET"),
+
+        new ArgumentOption<Arguments>(
+            [] (Arguments &state, const std::string &charset) {
+                state.customCharsets[3] = charset;
+            }, "custom-charset4", '4', "define the charset ?4 of the mask", "", "CHARSET"),
+
+        new FlagOption<Arguments>(
+            [] (Arguments &state) { state.increment = true; },
+            "increment", 'i', "also try the shorter candidates of the mask"),
+
+        new ArgumentOption<Arguments>(
+            makeNumericHandler<Arguments, std::size_t>([] (Arguments &state, std::size_t length) {
+                state.incrementMin = length;
+            }), "increment-min", '\0', "the shortest candidates to try with --increment", "1", "N"),
+
+        new ArgumentOption<Arguments>(
+            makeNumericHandler<Arguments, std::size_t>([] (Arguments &state, std::size_t length) {
+                state.incrementMax = length;
+            }), "increment-max", '\0', "the longest candidates to try with --increment", "mask length", "N"),
+
+        new ArgumentOption<Arguments>(
+            makeNumericHandler<Arguments, unsigned long long>([] (Arguments &state, unsigned long long skip) {
+                state.skip = skip;
+            }), "skip", '\0', "start at this index of the mask keyspace", "0", "N"),
+
+        new ArgumentOption<Arguments>(
+            makeNumericHandler<Arguments, unsigned long long>([] (Arguments &state, unsigned long long limit) {
+                state.limit = limit;
+            }), "limit", '\0', "try at most this many candidates of the mask keyspace", "all", "N"),
+
+        new ArgumentOption<Arguments>(
+            [] (Arguments &state, const std::string &path) {
+                state.rules = path;
+            }, "rules", '\0', "apply every rule of this (hashcat) rule file to every word", "none", "FILE"),
+
+        new FlagOption<Arguments>(
+            [] (Arguments &state) { state.showHelp = true; },
+            "help", '?', "show this help and exit")
+    };
+
+    return CommandLineParser<Arguments>(
+        "An association attack cracker for Argon2 hashes.",
+        positional, options);
 }
 
-int main(int argc, const char *const *argv) {
-    if (argc != 5){
-        std::cout << "Usage: argon2-kraken [mode: opencl or cuda] [leftlist] [wordlist] [potfile]" << std::endl;
+int main(int, const char *const *argv) {
+    CommandLineParser<Arguments> parser = buildCmdLineParser();
+
+    Arguments args;
+    int ret = parser.parseArguments(args, argv);
+    if (ret != 0) {
+        return ret;
+    }
+    if (args.showHelp) {
+        parser.printHelp(argv);
+        return 0;
+    }
+
+    std::size_t expected = args.listDevices ? 1 : 4;
+    if (args.positional.size() != expected) {
+        std::cout << "Usage: argon2-kraken [options] [mode: opencl, cuda or cpu] [leftlist] [wordlist] [potfile]" << std::endl;
         return -1;
     }
 
-    // Build the tasks map
-    std::map<std::string, std::vector<std::string>> tasks = buildTasks(argv[2], argv[3]);
+    auto &tuningCache = argon2::TuningCache::instance();
+    if (!args.tuningCache.empty()) {
+        tuningCache.setPath(args.tuningCache);
+    }
+    tuningCache.setRetune(args.retune);
 
-    processTasks(tasks, argv[1], argv[4]);
+    std::string mode = args.positional[0];
+    if (mode == "opencl") {
+        run<argon2::opencl::Device, argon2::opencl::GlobalContext, argon2::opencl::ProgramContext, argon2::opencl::ProcessingUnit>(args);
+    } else if (mode == "cuda") {
+        run<argon2::cuda::Device, argon2::cuda::GlobalContext, argon2::cuda::ProgramContext, argon2::cuda::ProcessingUnit>(args);
+    } else if (mode == "cpu") {
+        run<argon2::cpu::Device, argon2::cpu::GlobalContext, argon2::cpu::ProgramContext, argon2::cpu::ProcessingUnit>(args);
+    } else {
+        std::cout << "Unknwon mode " << mode << " user cuda, opencl or cpu" << std::endl;
+        return -1;
+    }
+    if (args.listDevices) {
+        return 0;
+    }
 
     std::cout << "Done" << std::endl;
     return 0;
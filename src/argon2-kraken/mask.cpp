@@ -0,0 +1,134 @@
+#include <limits>
+#include <stdexcept>
+
+#include "mask.hpp"
+
+
+static std::string getBuiltinCharset(char name)
+{
+    static const std::string lower = "abcdefghijklmnopqrstuvwxyz";
+    static const std::string upper = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    static const std::string digits = "0123456789";
+    static const std::string symbols = " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+
+    switch (name) {
+    case 'l': return lower;
+    case 'u': return upper;
+    case 'd': return digits;
+    case 's': return symbols;
+    case 'a': return lower + upper + digits + symbols;
+    case 'h': return digits + "abcdef";
+    case 'H': return digits + "ABCDEF";
+    case 'b': {
+        std::string bytes(256, '\0');
+        for (std::size_t i = 0; i < bytes.size(); i++) {
+            bytes[i] = static_cast<char>(i);
+        }
+        return bytes;
+    }
+    case '?': return "?";
+    default:
+        throw std::runtime_error(std::string("Unknown charset ?") + name);
+    }
+}
+
+// ExpandCharset resolves the charset references in a custom charset and
+// drops repeated characters
+static std::string expandCharset(const std::string &definition)
+{
+    std::string charset;
+    bool seen[256] = {};
+    for (std::size_t i = 0; i < definition.size(); i++) {
+        std::string chars(1, definition[i]);
+        if (definition[i] == '?') {
+            if (++i == definition.size()) {
+                throw std::runtime_error("Charset '" + definition + "' ends with '?'");
+            }
+            chars = getBuiltinCharset(definition[i]);
+        }
+        for (char c : chars) {
+            if (!seen[static_cast<unsigned char>(c)]) {
+                seen[static_cast<unsigned char>(c)] = true;
+                charset += c;
+            }
+        }
+    }
+    return charset;
+}
+
+Mask::Mask(const std::string &mask, const std::vector<std::string> &customCharsets,
+           std::size_t minLength, std::size_t maxLength)
+{
+    if (customCharsets.size() > CustomCharsets) {
+        throw std::runtime_error("Too many custom charsets");
+    }
+
+    for (std::size_t i = 0; i < mask.size(); i++) {
+        if (mask[i] != '?') {
+            positions.push_back(std::string(1, mask[i]));
+            continue;
+        }
+        if (++i == mask.size()) {
+            throw std::runtime_error("Mask '" + mask + "' ends with '?'");
+        }
+
+        char name = mask[i];
+        if (name >= '1' && name < static_cast<char>('1' + CustomCharsets)) {
+            std::size_t index = static_cast<std::size_t>(name - '1');
+            if (index >= customCharsets.size() || customCharsets[index].empty()) {
+                throw std::runtime_error(std::string("Custom charset ?") + name + " is not defined");
+            }
+            positions.push_back(expandCharset(customCharsets[index]));
+        } else {
+            positions.push_back(getBuiltinCharset(name));
+        }
+    }
+
+    if (maxLength == 0 || maxLength > positions.size()) {
+        maxLength = positions.size();
+    }
+    if (minLength == 0) {
+        minLength = maxLength;
+    }
+    if (maxLength == 0 || minLength > maxLength) {
+        throw std::runtime_error("Mask '" + mask + "' has no candidates of the requested lengths");
+    }
+    this->minLength = minLength;
+
+    std::uint64_t max = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t count = 1;
+    keyspace = 0;
+    for (std::size_t length = 1; length <= maxLength; length++) {
+        std::uint64_t size = positions[length - 1].size();
+        if (count > max / size) {
+            throw std::runtime_error("The keyspace of mask '" + mask + "' is too large");
+        }
+        count *= size;
+        if (length >= minLength) {
+            if (keyspace > max - count) {
+                throw std::runtime_error("The keyspace of mask '" + mask + "' is too large");
+            }
+            keyspace += count;
+            lengthKeyspaces.push_back(count);
+        }
+    }
+}
+
+std::size_t Mask::generate(std::uint64_t index, char *out) const
+{
+    std::size_t length = minLength;
+    for (std::uint64_t count : lengthKeyspaces) {
+        if (index < count) {
+            break;
+        }
+        index -= count;
+        length++;
+    }
+
+    for (std::size_t i = 0; i < length; i++) {
+        const std::string &charset = positions[i];
+        out[i] = charset[index % charset.size()];
+        index /= charset.size();
+    }
+    return length;
+}
@@ -0,0 +1,49 @@
+#ifndef MASK_H
+#define MASK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "candidate_source.hpp"
+
+
+// Mask is a hashcat-style mask: a list of positions, each taking every
+// character of its charset. Charsets are written as ?l (a-z), ?u (A-Z),
+// ?d (0-9), ?s (printable symbols and space), ?a (?l?u?d?s), ?h/?H
+// (lower/upper case hex digits), ?b (every byte), ?? (a literal '?') and
+// ?1 to ?4 (the custom charsets); any other character stands for itself.
+//
+// Every candidate has an index in the keyspace, so candidates are
+// generated on demand instead of being stored. The first position varies
+// fastest. With an increment range, the candidates of every length from
+// minLength to maxLength (taking the first positions of the mask) follow
+// each other, shortest first.
+class Mask : public CandidateSource
+{
+private:
+    std::vector<std::string> positions;
+    std::size_t minLength;
+
+    // The number of candidates of each length from minLength on
+    std::vector<std::uint64_t> lengthKeyspaces;
+    std::uint64_t keyspace;
+
+public:
+    static const std::size_t CustomCharsets = 4;
+
+    // Throws std::runtime_error on a malformed mask or charset, an empty
+    // keyspace or one with more than 2^64 - 1 candidates. A zero length
+    // limit means the length of the mask.
+    Mask(const std::string &mask, const std::vector<std::string> &customCharsets,
+         std::size_t minLength = 0, std::size_t maxLength = 0);
+
+    std::uint64_t getKeyspace() const { return keyspace; }
+    std::size_t getMaxLength() const override { return minLength + lengthKeyspaces.size() - 1; }
+
+    // The index has to be less than the keyspace
+    std::size_t generate(std::uint64_t index, char *out) const override;
+};
+
+#endif // MASK_H
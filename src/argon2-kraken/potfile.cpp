@@ -0,0 +1,41 @@
+#include <stdexcept>
+
+#include "line_reader.hpp"
+#include "potfile.hpp"
+
+
+Potfile::Potfile(const std::string &path)
+{
+    LineReader existing(path);
+    if (existing.isOpen()) {
+        // Encoded Argon2 hashes never contain a colon, while the candidate may.
+        std::string line;
+        while (existing.next(line)) {
+            std::size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                cracked.insert(line.substr(0, colon));
+            }
+        }
+    }
+
+    file.open(path, std::ios::app);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open potfile " + path);
+    }
+}
+
+bool Potfile::isCracked(const std::string &hash) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return cracked.count(hash) != 0;
+}
+
+bool Potfile::add(const std::string &hash, const std::string &candidate)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!cracked.insert(hash).second) {
+        return false;
+    }
+    file << hash << ":" << candidate << std::endl;
+    return true;
+}
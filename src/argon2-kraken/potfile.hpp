@@ -0,0 +1,36 @@
+#ifndef POTFILE_H
+#define POTFILE_H
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+
+// Potfile appends cracked hashes ("hash:candidate") to a file and keeps the
+// set of hashes cracked so far -- by this run or by earlier ones that wrote
+// to the same file -- so that the reader and the workers can skip them. It
+// is shared by all threads.
+class Potfile
+{
+private:
+    mutable std::mutex mutex;
+    std::unordered_set<std::string> cracked;
+    std::ofstream file;
+
+public:
+    // Loads the entries of the given file and opens it for appending;
+    // throws std::runtime_error if it cannot be opened
+    explicit Potfile(const std::string &path);
+
+    Potfile(const Potfile &) = delete;
+    Potfile &operator=(const Potfile &) = delete;
+
+    bool isCracked(const std::string &hash) const;
+
+    // Add writes the entry (and flushes it) unless the hash was cracked
+    // already; returns whether it was written
+    bool add(const std::string &hash, const std::string &candidate);
+};
+
+#endif // POTFILE_H
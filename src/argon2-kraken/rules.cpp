@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "line_reader.hpp"
+#include "rules.hpp"
+
+
+static std::size_t parsePosition(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return static_cast<std::size_t>(c - '0');
+    }
+    if (c >= 'A' && c <= 'Z') {
+        return static_cast<std::size_t>(c - 'A' + 10);
+    }
+    throw std::runtime_error(std::string("Invalid position '") + c + "'");
+}
+
+static bool isLower(char c) { return c >= 'a' && c <= 'z'; }
+static bool isUpper(char c) { return c >= 'A' && c <= 'Z'; }
+static char toLower(char c) { return isUpper(c) ? static_cast<char>(c - 'A' + 'a') : c; }
+static char toUpper(char c) { return isLower(c) ? static_cast<char>(c - 'a' + 'A') : c; }
+static char toggle(char c) { return isLower(c) ? toUpper(c) : toLower(c); }
+
+Rule::Rule(const std::string &rule)
+{
+    std::size_t i = 0;
+    auto next = [&]() -> char {
+        if (i == rule.size()) {
+            throw std::runtime_error("Rule '" + rule + "' is cut short");
+        }
+        return rule[i++];
+    };
+
+    while (i < rule.size()) {
+        Function f { rule[i++], 0, 0, '\0', '\0' };
+        switch (f.name) {
+        case ' ':
+            continue;
+        case ':': case 'l': case 'u': case 'c': case 'C': case 't': case 'E':
+        case 'r': case 'd': case 'f': case '{': case '}': case 'q':
+        case '[': case ']': case 'k': case 'K':
+            break;
+        case 'T': case 'p': case 'D': case '\'': case 'z': case 'Z': case 'y': case 'Y':
+        case 'L': case 'R': case '+': case '-': case '.': case ',':
+            f.n = parsePosition(next());
+            break;
+        case 'x': case 'O': case '*':
+            f.n = parsePosition(next());
+            f.m = parsePosition(next());
+            break;
+        case 'i': case 'o':
+            f.n = parsePosition(next());
+            f.x = next();
+            break;
+        case '$': case '^': case '@': case 'e':
+            f.x = next();
+            break;
+        case 's':
+            f.x = next();
+            f.y = next();
+            break;
+        default:
+            throw std::runtime_error(std::string("Unsupported rule function '") + f.name + "'");
+        }
+        functions.push_back(f);
+    }
+}
+
+std::size_t Rule::apply(const char *word, std::size_t length, char *out) const
+{
+    std::size_t len = std::min(length, MaxLength);
+    std::memcpy(out, word, len);
+
+    for (const Function &f : functions) {
+        std::size_t n = f.n, m = f.m;
+        switch (f.name) {
+        case 'l':
+            std::transform(out, out + len, out, toLower);
+            break;
+        case 'u':
+            std::transform(out, out + len, out, toUpper);
+            break;
+        case 'c':
+        case 'C':
+            for (std::size_t j = 0; j < len; j++) {
+                bool upper = (j == 0) == (f.name == 'c');
+                out[j] = upper ? toUpper(out[j]) : toLower(out[j]);
+            }
+            break;
+        case 't':
+            std::transform(out, out + len, out, toggle);
+            break;
+        case 'T':
+            if (n < len) {
+                out[n] = toggle(out[n]);
+            }
+            break;
+        case 'E':
+        case 'e': {
+            char separator = f.name == 'E' ? ' ' : f.x;
+            for (std::size_t j = 0; j < len; j++) {
+                bool upper = j == 0 || out[j - 1] == separator;
+                out[j] = upper ? toUpper(out[j]) : toLower(out[j]);
+            }
+            break;
+        }
+        case 'r':
+            std::reverse(out, out + len);
+            break;
+        case 'd':
+            if (2 * len <= MaxLength) {
+                std::memcpy(out + len, out, len);
+                len *= 2;
+            }
+            break;
+        case 'p':
+            if ((n + 1) * len <= MaxLength) {
+                for (std::size_t k = 1; k <= n; k++) {
+                    std::memcpy(out + k * len, out, len);
+                }
+                len *= n + 1;
+            }
+            break;
+        case 'f':
+            if (2 * len <= MaxLength) {
+                for (std::size_t j = 0; j < len; j++) {
+                    out[len + j] = out[len - 1 - j];
+                }
+                len *= 2;
+            }
+            break;
+        case '{':
+            if (len > 0) {
+                std::rotate(out, out + 1, out + len);
+            }
+            break;
+        case '}':
+            if (len > 0) {
+                std::rotate(out, out + len - 1, out + len);
+            }
+            break;
+        case 'q':
+            if (2 * len <= MaxLength) {
+                for (std::size_t j = len; j-- > 0;) {
+                    out[2 * j] = out[2 * j + 1] = out[j];
+                }
+                len *= 2;
+            }
+            break;
+        case '$':
+            if (len < MaxLength) {
+                out[len++] = f.x;
+            }
+            break;
+        case '^':
+            if (len < MaxLength) {
+                std::memmove(out + 1, out, len++);
+                out[0] = f.x;
+            }
+            break;
+        case '[':
+            if (len > 0) {
+                std::memmove(out, out + 1, --len);
+            }
+            break;
+        case ']':
+            if (len > 0) {
+                len--;
+            }
+            break;
+        case 'D':
+            if (n < len) {
+                std::memmove(out + n, out + n + 1, len - n - 1);
+                len--;
+            }
+            break;
+        case '\'':
+            if (n < len) {
+                len = n;
+            }
+            break;
+        case 'x':
+            if (n + m <= len) {
+                std::memmove(out, out + n, m);
+                len = m;
+            }
+            break;
+        case 'O':
+            if (n + m <= len) {
+                std::memmove(out + n, out + n + m, len - n - m);
+                len -= m;
+            }
+            break;
+        case 'i':
+            if (n <= len && len < MaxLength) {
+                std::memmove(out + n + 1, out + n, len - n);
+                out[n] = f.x;
+                len++;
+            }
+            break;
+        case 'o':
+            if (n < len) {
+                out[n] = f.x;
+            }
+            break;
+        case 's':
+            std::replace(out, out + len, f.x, f.y);
+            break;
+        case '@':
+            len = static_cast<std::size_t>(std::remove(out, out + len, f.x) - out);
+            break;
+        case 'z':
+            if (len > 0 && len + n <= MaxLength) {
+                char first = out[0];
+                std::memmove(out + n, out, len);
+                std::memset(out, first, n);
+                len += n;
+            }
+            break;
+        case 'Z':
+            if (len > 0 && len + n <= MaxLength) {
+                std::memset(out + len, out[len - 1], n);
+                len += n;
+            }
+            break;
+        case 'y':
+            if (n <= len && len + n <= MaxLength) {
+                std::memmove(out + n, out, len);
+                std::memcpy(out, out + n, n);
+                len += n;
+            }
+            break;
+        case 'Y':
+            if (n <= len && len + n <= MaxLength) {
+                std::memcpy(out + len, out + len - n, n);
+                len += n;
+            }
+            break;
+        case 'k':
+            if (len >= 2) {
+                std::swap(out[0], out[1]);
+            }
+            break;
+        case 'K':
+            if (len >= 2) {
+                std::swap(out[len - 2], out[len - 1]);
+            }
+            break;
+        case '*':
+            if (n < len && m < len) {
+                std::swap(out[n], out[m]);
+            }
+            break;
+        case 'L':
+            if (n < len) {
+                out[n] = static_cast<char>(static_cast<unsigned char>(out[n]) << 1);
+            }
+            break;
+        case 'R':
+            if (n < len) {
+                out[n] = static_cast<char>(static_cast<unsigned char>(out[n]) >> 1);
+            }
+            break;
+        case '+':
+            if (n < len) {
+                out[n]++;
+            }
+            break;
+        case '-':
+            if (n < len) {
+                out[n]--;
+            }
+            break;
+        case '.':
+            if (n + 1 < len) {
+                out[n] = out[n + 1];
+            }
+            break;
+        case ',':
+            if (n >= 1 && n < len) {
+                out[n] = out[n - 1];
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return len;
+}
+
+RuleSet::RuleSet(const std::string &path)
+{
+    LineReader file(path);
+    if (!file.isOpen()) {
+        throw std::runtime_error("Cannot open rule file " + path);
+    }
+
+    std::string line;
+    std::size_t lineNumber = 0;
+    while (file.next(line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        try {
+            rules.push_back(Rule(line));
+        } catch (const std::exception &err) {
+            std::cerr << "WARNING: Skipping line " << lineNumber
+                      << " of rule file - " << err.what() << std::endl;
+        }
+    }
+    if (rules.empty()) {
+        throw std::runtime_error("No usable rules in " + path);
+    }
+}
+
+RuleCandidates::RuleCandidates(std::shared_ptr<const RuleSet> rules)
+    : rules(std::move(rules))
+{
+}
+
+std::uint64_t RuleCandidates::addWord(const std::string &word)
+{
+    words += word;
+    ends.push_back(words.size());
+    maxWordLength = std::max(maxWordLength, word.size());
+    return static_cast<std::uint64_t>(ends.size() - 1) * getRuleCount();
+}
+
+std::size_t RuleCandidates::generate(std::uint64_t index, char *out) const
+{
+    std::size_t word = static_cast<std::size_t>(index / getRuleCount());
+    std::size_t begin = word == 0 ? 0 : ends[word - 1];
+    std::size_t length = ends[word] - begin;
+    if (!rules) {
+        std::memcpy(out, words.data() + begin, length);
+        return length;
+    }
+    const Rule &rule = (*rules)[static_cast<std::size_t>(index % rules->size())];
+    return rule.apply(words.data() + begin, length, out);
+}
@@ -0,0 +1,97 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "candidate_source.hpp"
+
+
+// Rule is one line of a hashcat rule file: a list of functions applied to
+// a word one after another. The supported functions are
+//
+//   :  l u c C t TN E eX             nothing, case changes
+//   r d pN f { } q                   reverse, duplicate, reflect, rotate
+//   $X ^X [ ] DN 'N xNM ONM iNX oNX  append, prepend, delete, insert...
+//   sXY @X zN ZN yN YN               replace, purge, duplicate parts
+//   k K *NM LN RN +N -N .N ,N        swap and change single characters
+//
+// where N and M are positions (0-9, A-Z for 10-35) and X, Y characters.
+// Functions whose position is out of range, or that would make the word
+// longer than MaxLength, leave it unchanged. Rejection and memory
+// functions are not supported.
+class Rule
+{
+private:
+    struct Function
+    {
+        char name;
+        std::size_t n;
+        std::size_t m;
+        char x;
+        char y;
+    };
+
+    std::vector<Function> functions;
+
+public:
+    static const std::size_t MaxLength = 256;
+
+    // Throws std::runtime_error on a malformed or unsupported rule
+    explicit Rule(const std::string &rule);
+
+    // Apply writes the word transformed by the rule to out, which has to
+    // hold MaxLength bytes, and returns its length. Longer words are cut
+    // to MaxLength first.
+    std::size_t apply(const char *word, std::size_t length, char *out) const;
+};
+
+// RuleSet holds the rules of a rule file
+class RuleSet
+{
+private:
+    std::vector<Rule> rules;
+
+public:
+    // Skips empty lines and comments (#), and warns about (and skips) the
+    // rules that cannot be parsed; throws std::runtime_error if the file
+    // cannot be read or has no usable rule
+    explicit RuleSet(const std::string &path);
+
+    std::size_t size() const { return rules.size(); }
+    const Rule &operator[](std::size_t index) const { return rules[index]; }
+};
+
+// RuleCandidates is a compact arena of base words, each of which stands
+// for one candidate per rule of a RuleSet (candidate word * rules + rule),
+// or for itself if there are no rules. A batch keeps the words of its own
+// jobs, and the rules are applied when the batch is launched.
+class RuleCandidates : public CandidateSource
+{
+private:
+    std::shared_ptr<const RuleSet> rules;
+    std::string words;
+    std::vector<std::size_t> ends;
+    std::size_t maxWordLength = 0;
+
+    std::size_t getRuleCount() const { return rules ? rules->size() : 1; }
+
+public:
+    // Rules may be null
+    explicit RuleCandidates(std::shared_ptr<const RuleSet> rules);
+
+    // AddWord appends a base word and returns the index of its first
+    // candidate
+    std::uint64_t addWord(const std::string &word);
+
+    std::size_t getMaxLength() const override
+    {
+        return rules ? Rule::MaxLength : maxWordLength;
+    }
+    std::size_t generate(std::uint64_t index, char *out) const override;
+};
+
+#endif // RULES_H
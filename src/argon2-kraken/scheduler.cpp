@@ -0,0 +1,38 @@
+#include <algorithm>
+
+#include "scheduler.hpp"
+
+
+// Leave some device memory for the driver, kernels and other processes.
+static std::uint64_t getUsableMemory(const DeviceLimits &limits)
+{
+    return limits.globalMemory - limits.globalMemory / 10;
+}
+
+static std::size_t getMaxWorkers(const DeviceLimits &limits)
+{
+    return limits.maxWorkers == 0 ? MaxWorkersPerDevice
+                                  : std::min(limits.maxWorkers, MaxWorkersPerDevice);
+}
+
+std::size_t getMaxBatchMemory(const DeviceLimits &limits)
+{
+    if (limits.globalMemory == 0) {
+        return DefaultBatchMemory;
+    }
+
+    std::uint64_t memory = getUsableMemory(limits)
+            / std::min(MinWorkersPerDevice, getMaxWorkers(limits));
+    return static_cast<std::size_t>(std::max<std::uint64_t>(memory, 1));
+}
+
+std::size_t getWorkerCount(const DeviceLimits &limits, std::size_t maxBatchMemory)
+{
+    if (limits.globalMemory == 0) {
+        return std::min(MinWorkersPerDevice, getMaxWorkers(limits));
+    }
+
+    std::uint64_t workers = getUsableMemory(limits) / maxBatchMemory;
+    return static_cast<std::size_t>(std::max<std::uint64_t>(
+        1, std::min<std::uint64_t>(workers, getMaxWorkers(limits))));
+}
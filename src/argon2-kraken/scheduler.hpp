@@ -0,0 +1,110 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <vector>
+
+#include "argon2-cpu/device.h"
+
+#include "batch.hpp"
+#include "batch_runner.hpp"
+#include "bounded_queue.hpp"
+
+
+// DeviceLimits describes the memory of one device, in bytes. Zero means
+// unknown (e.g. a backend built without device support). maxWorkers caps
+// the number of workers on the device (zero means MaxWorkersPerDevice).
+struct DeviceLimits
+{
+    std::uint64_t globalMemory;
+    std::size_t maxWorkers;
+};
+
+// A device is kept busy by at least two workers (one hashing while the other
+// prepares or checks its batch), and at most MaxWorkersPerDevice.
+const std::size_t MinWorkersPerDevice = 2;
+const std::size_t MaxWorkersPerDevice = 4;
+
+// GetMaxBatchMemory returns how much device memory a single batch may use.
+// MinWorkersPerDevice batches (or maxWorkers, if fewer) have to fit on the
+// device at once; the backends split a batch across several allocations
+// where needed.
+std::size_t getMaxBatchMemory(const DeviceLimits &limits);
+
+// GetWorkerCount returns how many batches of maxBatchMemory the device can
+// hold at once, clamped to [1, MaxWorkersPerDevice] and to maxWorkers
+std::size_t getWorkerCount(const DeviceLimits &limits, std::size_t maxBatchMemory);
+
+template <class Device>
+DeviceLimits getDeviceLimits(const Device &device)
+{
+    return DeviceLimits { device.getGlobalMemorySize(), 0 };
+}
+
+// A CPU ProcessingUnit already runs one job per hardware thread, with its
+// own pool and arenas, so a second worker would only oversubscribe the
+// cores and duplicate the memory.
+inline DeviceLimits getDeviceLimits(const argon2::cpu::Device &device)
+{
+    return DeviceLimits { device.getGlobalMemorySize(), 1 };
+}
+
+// DeviceWorkers is the number of persistent workers to run on one device
+struct DeviceWorkers
+{
+    std::size_t deviceIndex;
+    std::size_t workerCount;
+};
+
+// RunWorkers starts the given workers on each device, all pulling batches
+// from the shared queue until it is closed and drained, and waits for them.
+// Each worker's unit takes at most maxBatchMemory bytes of device memory.
+// Batches are handed out on demand, so faster devices simply take more of
+// them. onMatch is called (from the worker threads) with every job whose
+// hash matches its target, along with its candidate, and onFinished once
+// all jobs of a batch were hashed and their matches reported. If a worker
+// fails, the queue is closed so the producer and the other workers stop,
+// and the error is rethrown.
+template <class Device, class GlobalContext, class ProgramContext, class ProcessingUnit>
+void runWorkers(
+    const std::vector<DeviceWorkers> &devices,
+    std::size_t maxBatchMemory,
+    BoundedQueue<Batch> &queue,
+    const std::function<void(const Job &, const std::string &)> &onMatch,
+    const std::function<void(const Batch &)> &onFinished
+){
+    auto work = [maxBatchMemory, &queue, &onMatch, &onFinished](std::size_t deviceIndex) {
+        try {
+            BatchRunner<Device, GlobalContext, ProgramContext, ProcessingUnit> runner(deviceIndex, maxBatchMemory);
+
+            Batch batch;
+            while (queue.pop(batch)) {
+                runner.run(batch, [&batch, &onMatch](std::size_t i) {
+                    onMatch(batch.jobs[i], getCandidate(batch, batch.jobs[i]));
+                });
+                onFinished(batch);
+            }
+        } catch (...) {
+            queue.close();
+            throw;
+        }
+    };
+
+    std::vector<std::future<void>> workers;
+    for (const auto &device : devices) {
+        for (std::size_t i = 0; i < device.workerCount; i++) {
+            workers.emplace_back(std::async(std::launch::async, work, device.deviceIndex));
+        }
+    }
+    for (auto &worker : workers) {
+        worker.wait();
+    }
+    for (auto &worker : workers) {
+        worker.get();
+    }
+}
+
+#endif // SCHEDULER_H
@@ -0,0 +1,65 @@
+#include <string>
+#include <tuple>
+
+#include "hash_parser.hpp"
+#include "strings_tools.hpp"
+#include "target.hpp"
+
+
+Target::Target(
+    const std::string &line, argon2::Type type, argon2::Version version,
+    const std::string &salt, const std::string &tag,
+    std::uint32_t timeCost, std::uint32_t memoryCost, std::uint32_t parallelism)
+    : line(line), type(type), version(version), salt(salt), tag(tag),
+      params(this->tag.size(),
+             this->salt.data(), this->salt.size(),
+             nullptr, 0,
+             nullptr, 0,
+             timeCost, memoryCost, parallelism),
+      cracked(false)
+{
+}
+
+bool ParamsKey::operator<(const ParamsKey &other) const
+{
+    return std::tie(type, version, outputLength, timeCost, memoryCost, lanes)
+        < std::tie(other.type, other.version, other.outputLength,
+                   other.timeCost, other.memoryCost, other.lanes);
+}
+
+bool ParamsKey::operator==(const ParamsKey &other) const
+{
+    return std::tie(type, version, outputLength, timeCost, memoryCost, lanes)
+        == std::tie(other.type, other.version, other.outputLength,
+                    other.timeCost, other.memoryCost, other.lanes);
+}
+
+// ParseTarget parses an Argon2 hash string into a Target
+std::shared_ptr<Target> parseTarget(const std::string &line)
+{
+    Argon2ParamsData paramsData = parseArgon2Hash(line);
+
+    std::string salt = paramsData.salt;
+
+    // TODO: Why do we get null in it and why .length() counts it in?
+    if (!salt.empty() && salt[salt.length() - 1] == 0) {
+        salt.pop_back();
+    }
+
+    return std::make_shared<Target>(
+        line, paramsData.type, paramsData.version,
+        salt, hexToString(paramsData.hash),
+        paramsData.timeCost, paramsData.memoryCost, paramsData.parallelism);
+}
+
+ParamsKey makeParamsKey(const Target &target)
+{
+    return ParamsKey {
+        target.type,
+        target.version,
+        target.params.getOutputLength(),
+        target.params.getTimeCost(),
+        target.params.getMemoryCost(),
+        target.params.getLanes(),
+    };
+}
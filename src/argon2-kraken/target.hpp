@@ -0,0 +1,56 @@
+#ifndef TARGET_H
+#define TARGET_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "argon2-gpu-common/argon2params.h"
+
+
+// Target is one parsed left-list hash. It owns the decoded salt and tag, and
+// its Argon2Params point into that storage, so a Target is never copied or
+// moved once built -- share it through std::shared_ptr instead.
+struct Target
+{
+    std::string line;
+    argon2::Type type;
+    argon2::Version version;
+    std::string salt;
+    std::string tag;
+    argon2::Argon2Params params;
+    std::atomic<bool> cracked;
+
+    Target(const std::string &line, argon2::Type type, argon2::Version version,
+           const std::string &salt, const std::string &tag,
+           std::uint32_t timeCost, std::uint32_t memoryCost,
+           std::uint32_t parallelism);
+
+    Target(const Target &) = delete;
+    Target &operator=(const Target &) = delete;
+};
+
+// ParamsKey is everything about a hash except its salt and tag. Hashes with
+// equal keys run the same kernel on the same memory layout, so their
+// candidates can share one ProcessingUnit batch.
+struct ParamsKey
+{
+    argon2::Type type;
+    argon2::Version version;
+    std::uint32_t outputLength;
+    std::uint32_t timeCost;
+    std::uint32_t memoryCost;
+    std::uint32_t lanes;
+
+    bool operator<(const ParamsKey &other) const;
+    bool operator==(const ParamsKey &other) const;
+};
+
+// ParseTarget parses an Argon2 hash string; throws std::runtime_error on
+// malformed input
+std::shared_ptr<Target> parseTarget(const std::string &line);
+
+ParamsKey makeParamsKey(const Target &target);
+
+#endif // TARGET_H
@@ -0,0 +1,472 @@
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+#include "line_reader.hpp"
+#include "rules.hpp"
+#include "task_reader.hpp"
+
+
+static void readBatchesImpl(const std::string &leftlist, const std::string &wordlist,
+                            const std::shared_ptr<const RuleSet> &rules,
+                            std::size_t maxBatchMemory, BoundedQueue<Batch> &queue,
+                            const Potfile &potfile, Checkpoint &checkpoint)
+{
+    LineReader llFile(leftlist);
+    if (!llFile.isOpen()) {
+        throw std::runtime_error("Cannot open llFile");
+    }
+
+    LineReader wlFile(wordlist);
+    if (!wlFile.isOpen()) {
+        throw std::runtime_error("Cannot open wlFile");
+    }
+
+    // With rules, a line stands for one job per rule and the batches and
+    // the checkpoint work on the positions in the lines x rules product, so
+    // the jobs of a line may be split across batches.
+    std::size_t max = std::numeric_limits<std::size_t>::max();
+    std::size_t ruleCount = rules ? rules->size() : 1;
+
+    InputPosition start = checkpoint.getStartPosition();
+    llFile.seek(start.leftlistOffset);
+    wlFile.seek(start.wordlistOffset);
+    InputPosition position { start.line / ruleCount * ruleCount,
+                             start.leftlistOffset, start.wordlistOffset };
+
+    std::map<std::string, std::weak_ptr<Target>> targets;
+    std::size_t pruneAt = MaxTrackedTargets;
+
+    std::map<ParamsKey, Batch> pending;
+    std::size_t pendingJobs = 0;
+
+    // The base words of the pending batches, when there are rules
+    std::map<ParamsKey, std::shared_ptr<RuleCandidates>> words;
+
+    // Candidates of targets cracked since they were read are dropped, so
+    // their slots go to the candidates of other targets.
+    auto compact = [&](Batch &batch) {
+        auto cracked = std::remove_if(batch.jobs.begin(), batch.jobs.end(), [](const Job &job) {
+            return job.target->cracked.load();
+        });
+        pendingJobs -= batch.jobs.end() - cracked;
+        batch.jobs.erase(cracked, batch.jobs.end());
+    };
+
+    // Returns false once the queue was closed (by a failing worker), so
+    // reading stops right away.
+    auto send = [&](std::map<ParamsKey, Batch>::iterator it) {
+        compact(it->second);
+        pendingJobs -= it->second.jobs.size();
+        bool sent = true;
+        if (it->second.jobs.empty()) {
+            // Its lines are all in the potfile now.
+            checkpoint.batchFinished(it->second);
+        } else {
+            sent = queue.push(std::move(it->second));
+        }
+        words.erase(it->first);
+        pending.erase(it);
+        return sent;
+    };
+
+    std::string hash, plain;
+    std::size_t lineNumber = start.line / ruleCount;
+    while (llFile.next(hash) && wlFile.next(plain)) {
+        InputPosition lineStart = position;
+        lineNumber++;
+        if (lineNumber > max / ruleCount) {
+            throw std::runtime_error("Too many candidates for the rules");
+        }
+        position = InputPosition { lineNumber * ruleCount, llFile.getOffset(), wlFile.getOffset() };
+        checkpoint.lineRead(position);
+
+        if (potfile.isCracked(hash)) {
+            continue;
+        }
+
+        std::shared_ptr<Target> target;
+        auto known = targets.find(hash);
+        if (known != targets.end()) {
+            target = known->second.lock();
+        }
+        if (!target) {
+            try {
+                target = parseTarget(hash);
+            } catch (const std::exception &err) {
+                std::cerr << "WARNING: Skipping line " << lineNumber
+                          << " of leftlist - " << err.what() << std::endl;
+                continue;
+            }
+            targets[hash] = target;
+        }
+
+        ParamsKey key = makeParamsKey(*target);
+        std::size_t batchSize = getBatchSize(target->params, maxBatchMemory);
+
+        // The word of this line in the pending batch of the key, if added
+        std::shared_ptr<RuleCandidates> lineWords;
+        std::uint64_t first = 0;
+        for (std::size_t r = 0; r < ruleCount; r++) {
+            // One-based, as in batches and checkpoints
+            std::size_t job = lineStart.line + r + 1;
+            if (job <= start.line || checkpoint.isFinished(key, job)) {
+                continue;
+            }
+
+            auto it = pending.find(key);
+            if (it == pending.end()) {
+                it = pending.insert(std::make_pair(key, Batch { key, {}, job, job, nullptr })).first;
+                if (rules) {
+                    it->second.source = words[key] = std::make_shared<RuleCandidates>(rules);
+                }
+                checkpoint.batchOpened(InputPosition { job - 1, lineStart.leftlistOffset,
+                                                       lineStart.wordlistOffset });
+            }
+            if (rules) {
+                // The rules are only applied when the batch is launched.
+                if (lineWords != words[key]) {
+                    lineWords = words[key];
+                    first = lineWords->addWord(plain);
+                }
+                it->second.jobs.push_back(Job { target, std::string(), first + r });
+            } else {
+                it->second.jobs.push_back(Job { target, plain, 0 });
+            }
+            it->second.lastLine = job;
+            pendingJobs++;
+
+            if (it->second.jobs.size() >= batchSize) {
+                compact(it->second);
+            }
+            if (it->second.jobs.size() >= batchSize) {
+                if (!send(it)) {
+                    return;
+                }
+            } else if (pendingJobs >= MaxPendingJobs) {
+                auto largest = pending.begin();
+                for (auto p = pending.begin(); p != pending.end(); ++p) {
+                    if (p->second.jobs.size() > largest->second.jobs.size()) {
+                        largest = p;
+                    }
+                }
+                if (!send(largest)) {
+                    return;
+                }
+            }
+        }
+
+        if (targets.size() >= pruneAt) {
+            for (auto t = targets.begin(); t != targets.end();) {
+                if (t->second.expired()) {
+                    t = targets.erase(t);
+                } else {
+                    ++t;
+                }
+            }
+            pruneAt = std::max(MaxTrackedTargets, 2 * targets.size());
+        }
+    }
+
+    while (!pending.empty()) {
+        if (!send(pending.begin())) {
+            return;
+        }
+    }
+}
+
+void readBatches(const std::string &leftlist, const std::string &wordlist,
+                 const std::shared_ptr<const RuleSet> &rules,
+                 std::size_t maxBatchMemory, BoundedQueue<Batch> &queue,
+                 const Potfile &potfile, Checkpoint &checkpoint)
+{
+    try {
+        readBatchesImpl(leftlist, wordlist, rules, maxBatchMemory, queue, potfile, checkpoint);
+    } catch (...) {
+        queue.close();
+        throw;
+    }
+    queue.close();
+}
+
+// LoadTargets parses every distinct hash of the leftlist and groups them by
+// ParamsKey. Hashes in the potfile are kept (marked cracked), so the
+// positions of the others do not change when a run is restored.
+static std::map<ParamsKey, std::vector<std::shared_ptr<Target>>> loadTargets(
+        const std::string &leftlist, const Potfile &potfile)
+{
+    LineReader llFile(leftlist);
+    if (!llFile.isOpen()) {
+        throw std::runtime_error("Cannot open llFile");
+    }
+
+    std::map<std::string, std::shared_ptr<Target>> targets;
+    std::map<ParamsKey, std::vector<std::shared_ptr<Target>>> groups;
+
+    std::string hash;
+    std::size_t lineNumber = 0;
+    while (llFile.next(hash)) {
+        lineNumber++;
+        if (targets.count(hash) != 0) {
+            continue;
+        }
+
+        std::shared_ptr<Target> target;
+        try {
+            target = parseTarget(hash);
+        } catch (const std::exception &err) {
+            std::cerr << "WARNING: Skipping line " << lineNumber
+                      << " of leftlist - " << err.what() << std::endl;
+            continue;
+        }
+        target->cracked = potfile.isCracked(hash);
+        targets[hash] = target;
+        groups[makeParamsKey(*target)].push_back(target);
+    }
+    return groups;
+}
+
+static void readMaskBatchesImpl(const std::string &leftlist,
+                                const std::shared_ptr<const Mask> &mask,
+                                std::uint64_t begin, std::uint64_t end,
+                                std::size_t maxBatchMemory, BoundedQueue<Batch> &queue,
+                                const Potfile &potfile, Checkpoint &checkpoint)
+{
+    auto groups = loadTargets(leftlist, potfile);
+
+    // Position of the first job of the current group in the product
+    std::uint64_t base = 0;
+    std::uint64_t start = checkpoint.getStartPosition().line;
+    for (const auto &group : groups) {
+        const ParamsKey &key = group.first;
+        const auto &targets = group.second;
+
+        std::uint64_t count = targets.size();
+        if (end - begin > (std::numeric_limits<std::size_t>::max() - base) / count) {
+            throw std::runtime_error("Too many hashes for the keyspace of the mask");
+        }
+        std::uint64_t groupEnd = base + (end - begin) * count;
+
+        std::size_t batchSize = getBatchSize(targets[0]->params, maxBatchMemory);
+        std::uint64_t position = std::max(start, base);
+        while (position < groupEnd) {
+            // Candidates are the outer loop, so each batch tries a few of
+            // them against every uncracked hash of the group.
+            bool uncracked = std::any_of(targets.begin(), targets.end(),
+                                         [](const std::shared_ptr<Target> &target) {
+                return !target->cracked.load();
+            });
+            if (!uncracked) {
+                break;
+            }
+
+            Batch batch { key, {}, position + 1, 0, mask };
+            checkpoint.batchOpened(InputPosition { position, 0, 0 });
+            while (position < groupEnd && batch.jobs.size() < batchSize) {
+                std::uint64_t offset = position - base;
+                const auto &target = targets[offset % count];
+                position++;
+                if (target->cracked || checkpoint.isFinished(key, position)) {
+                    continue;
+                }
+                batch.jobs.push_back(Job { target, std::string(), begin + offset / count });
+            }
+            batch.lastLine = position;
+            checkpoint.lineRead(InputPosition { position, 0, 0 });
+
+            if (batch.jobs.empty()) {
+                checkpoint.batchFinished(batch);
+            } else if (!queue.push(std::move(batch))) {
+                return;
+            }
+        }
+        checkpoint.lineRead(InputPosition { groupEnd, 0, 0 });
+        base = groupEnd;
+    }
+}
+
+void readMaskBatches(const std::string &leftlist, const std::shared_ptr<const Mask> &mask,
+                     std::uint64_t begin, std::uint64_t end,
+                     std::size_t maxBatchMemory, BoundedQueue<Batch> &queue,
+                     const Potfile &potfile, Checkpoint &checkpoint)
+{
+    try {
+        readMaskBatchesImpl(leftlist, mask, begin, end, maxBatchMemory, queue, potfile, checkpoint);
+    } catch (...) {
+        queue.close();
+        throw;
+    }
+    queue.close();
+}
+
+static void readCrossBatchesImpl(const std::string &leftlist, const std::string &wordlist,
+                                 const std::shared_ptr<const RuleSet> &rules,
+                                 std::size_t maxBatchMemory, BoundedQueue<Batch> &queue,
+                                 const Potfile &potfile, Checkpoint &checkpoint)
+{
+    auto groups = loadTargets(leftlist, potfile);
+
+    std::size_t targetCount = 0;
+    for (const auto &group : groups) {
+        targetCount += group.second.size();
+    }
+    if (targetCount == 0) {
+        return;
+    }
+
+    // The product is numbered in the order it is read: by word, then by
+    // group, then by rule and then by target.
+    std::size_t max = std::numeric_limits<std::size_t>::max();
+    std::size_t ruleCount = rules ? rules->size() : 1;
+    if (targetCount > max / ruleCount) {
+        throw std::runtime_error("Too many hashes for the rules");
+    }
+    std::size_t wordPositions = targetCount * ruleCount;
+
+    LineReader wlFile(wordlist);
+    if (!wlFile.isOpen()) {
+        throw std::runtime_error("Cannot open wlFile");
+    }
+
+    InputPosition start = checkpoint.getStartPosition();
+    wlFile.seek(start.wordlistOffset);
+    std::size_t wordNumber = start.line / wordPositions;
+
+    struct PendingBatch
+    {
+        Batch batch;
+        std::shared_ptr<RuleCandidates> words;
+
+        // The last word added to the batch and its first candidate
+        std::size_t wordNumber;
+        std::uint64_t firstCandidate;
+    };
+    std::map<ParamsKey, PendingBatch> pending;
+    std::size_t pendingJobs = 0;
+
+    // As in readBatches, but candidates are only dropped from full batches
+    // (or when they are sent), so the slots go to the next candidates.
+    auto compact = [&](Batch &batch) {
+        auto cracked = std::remove_if(batch.jobs.begin(), batch.jobs.end(), [](const Job &job) {
+            return job.target->cracked.load();
+        });
+        pendingJobs -= batch.jobs.end() - cracked;
+        batch.jobs.erase(cracked, batch.jobs.end());
+    };
+
+    // Returns false once the queue was closed, as in readBatches.
+    auto send = [&](std::map<ParamsKey, PendingBatch>::iterator it) {
+        Batch &batch = it->second.batch;
+        compact(batch);
+        pendingJobs -= batch.jobs.size();
+        bool sent = true;
+        if (batch.jobs.empty()) {
+            checkpoint.batchFinished(batch);
+        } else {
+            sent = queue.push(std::move(batch));
+        }
+        pending.erase(it);
+        return sent;
+    };
+
+    std::string word;
+    std::uint64_t wordOffset = start.wordlistOffset;
+    while (wlFile.next(word)) {
+        // Stop once every hash is cracked.
+        bool uncracked = false;
+        for (auto group = groups.begin(); group != groups.end() && !uncracked; ++group) {
+            uncracked = std::any_of(group->second.begin(), group->second.end(),
+                                    [](const std::shared_ptr<Target> &target) {
+                return !target->cracked.load();
+            });
+        }
+        if (!uncracked) {
+            break;
+        }
+
+        if (wordNumber >= max / wordPositions) {
+            throw std::runtime_error("Too many candidates for the hashes");
+        }
+        std::size_t position = wordNumber * wordPositions;
+        for (const auto &group : groups) {
+            const ParamsKey &key = group.first;
+            const auto &targets = group.second;
+            std::size_t batchSize = getBatchSize(targets[0]->params, maxBatchMemory);
+
+            for (std::size_t r = 0; r < ruleCount; r++) {
+                for (const auto &target : targets) {
+                    // One-based, as in batches and checkpoints
+                    position++;
+                    if (position <= start.line || target->cracked
+                            || checkpoint.isFinished(key, position)) {
+                        continue;
+                    }
+
+                    auto it = pending.find(key);
+                    if (it == pending.end()) {
+                        auto words = std::make_shared<RuleCandidates>(rules);
+                        Batch batch { key, {}, position, position, words };
+                        it = pending.insert(std::make_pair(key, PendingBatch {
+                            std::move(batch), words, max, 0 })).first;
+                        checkpoint.batchOpened(InputPosition { position - 1, 0, wordOffset });
+                    }
+
+                    PendingBatch &entry = it->second;
+                    if (entry.wordNumber != wordNumber) {
+                        entry.firstCandidate = entry.words->addWord(word);
+                        entry.wordNumber = wordNumber;
+                    }
+                    entry.batch.jobs.push_back(Job { target, std::string(), entry.firstCandidate + r });
+                    entry.batch.lastLine = position;
+                    pendingJobs++;
+
+                    if (entry.batch.jobs.size() >= batchSize) {
+                        compact(entry.batch);
+                    }
+                    if (entry.batch.jobs.size() >= batchSize) {
+                        if (!send(it)) {
+                            return;
+                        }
+                    } else if (pendingJobs >= MaxPendingJobs) {
+                        auto largest = pending.begin();
+                        for (auto p = pending.begin(); p != pending.end(); ++p) {
+                            if (p->second.batch.jobs.size() > largest->second.batch.jobs.size()) {
+                                largest = p;
+                            }
+                        }
+                        if (!send(largest)) {
+                            return;
+                        }
+                    }
+                }
+            }
+        }
+
+        wordNumber++;
+        wordOffset = wlFile.getOffset();
+        checkpoint.lineRead(InputPosition { wordNumber * wordPositions, 0, wordOffset });
+    }
+
+    while (!pending.empty()) {
+        if (!send(pending.begin())) {
+            return;
+        }
+    }
+}
+
+void readCrossBatches(const std::string &leftlist, const std::string &wordlist,
+                      const std::shared_ptr<const RuleSet> &rules,
+                      std::size_t maxBatchMemory, BoundedQueue<Batch> &queue,
+                      const Potfile &potfile, Checkpoint &checkpoint)
+{
+    try {
+        readCrossBatchesImpl(leftlist, wordlist, rules, maxBatchMemory, queue, potfile, checkpoint);
+    } catch (...) {
+        queue.close();
+        throw;
+    }
+    queue.close();
+}
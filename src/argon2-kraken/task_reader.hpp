@@ -0,0 +1,77 @@
+#ifndef TASK_READER_H
+#define TASK_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "batch.hpp"
+#include "bounded_queue.hpp"
+#include "checkpoint.hpp"
+#include "mask.hpp"
+#include "rules.hpp"
+#include "potfile.hpp"
+
+
+// Upper bound on candidates held in not-yet-full batches. When it is hit the
+// largest pending batch is sent out early, which keeps memory bounded even
+// for left-lists that mix many different parameter sets.
+const std::size_t MaxPendingJobs = 4 * MaxBatchSize;
+
+// Parsed targets are remembered (weakly) so that repeated left-list lines
+// share one Target; the map is pruned of targets that are no longer
+// referenced by any batch once it grows past this size.
+const std::size_t MaxTrackedTargets = 4096;
+
+// ReadBatches streams the paired leftlist/wordlist files and pushes
+// batches of jobs grouped by ParamsKey into the queue. Each batch takes at
+// most maxBatchMemory bytes of device memory. Only the lines
+// that belong to pending or queued batches are kept in memory, so peak
+// memory does not depend on the size of the input. The queue is closed
+// when reading is done or fails.
+//
+// With rules (which may be null), every word of the wordlist stands for
+// one candidate per rule. The batches only keep the base words, and the
+// rules are applied by the workers when a batch is launched. The
+// candidates of a line may be split across batches, so the batches and the
+// checkpoint work on the positions in the lines x rules product.
+//
+// Lines whose hash is in the potfile are skipped, and candidates of
+// targets cracked while their batch was pending are dropped. Reading starts at the
+// checkpoint's start position, skips the lines of the batches it already
+// finished, and reports every line read and batch created to it.
+void readBatches(const std::string &leftlist, const std::string &wordlist,
+                 const std::shared_ptr<const RuleSet> &rules,
+                 std::size_t maxBatchMemory, BoundedQueue<Batch> &queue,
+                 const Potfile &potfile, Checkpoint &checkpoint);
+
+// ReadMaskBatches tries every hash of the leftlist against the candidates
+// [begin, end) of the mask's keyspace, so all the (distinct) hashes are
+// held in memory but no candidate is ever stored. The hashes are grouped
+// by ParamsKey; within a group the candidates form the outer loop and each
+// batch is filled with one candidate after another for every uncracked
+// hash. The jobs only carry keyspace indices, the candidates are generated
+// when a batch is launched. Hashes in the potfile are skipped, a group
+// stops once all its hashes are cracked, and the checkpoint works on the
+// positions in the hashes x candidates product.
+void readMaskBatches(const std::string &leftlist, const std::shared_ptr<const Mask> &mask,
+                     std::uint64_t begin, std::uint64_t end,
+                     std::size_t maxBatchMemory, BoundedQueue<Batch> &queue,
+                     const Potfile &potfile, Checkpoint &checkpoint);
+
+// ReadCrossBatches tries every hash of the leftlist against every word of
+// the wordlist (each expanded with the rules, which may be null), so the
+// input is O(hashes + words) rather than a wordlist repeated per hash. The
+// (distinct) hashes are held in memory and grouped by ParamsKey, while the
+// wordlist is streamed as the outer loop: each word is added to the
+// pending batch of every group, for every uncracked hash of the group.
+// Batches keep only the words of their own jobs. Hashes in the potfile are
+// skipped, reading stops once all hashes are cracked, and the checkpoint
+// works on the positions in the words x rules x hashes product.
+void readCrossBatches(const std::string &leftlist, const std::string &wordlist,
+                      const std::shared_ptr<const RuleSet> &rules,
+                      std::size_t maxBatchMemory, BoundedQueue<Batch> &queue,
+                      const Potfile &potfile, Checkpoint &checkpoint);
+
+#endif // TASK_READER_H